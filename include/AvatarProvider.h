@@ -17,10 +17,14 @@
 
 #pragma once
 
+#include <QHash>
 #include <QImage>
+#include <QPointer>
 #include <QSharedPointer>
 #include <QUrl>
 
+#include "Identifier.h"
+
 class MatrixClient;
 class TimelineItem;
 
@@ -36,8 +40,8 @@ class AvatarProvider : public QObject
 
 public:
         static void init(QSharedPointer<MatrixClient> client);
-        static void resolve(const QString &userId, TimelineItem *item);
-        static void setAvatarUrl(const QString &userId, const QUrl &url);
+        static void resolve(const Identifier &userId, TimelineItem *item);
+        static void setAvatarUrl(const Identifier &userId, const QUrl &url);
 
         static void clear();
 
@@ -46,7 +50,9 @@ private:
 
         static QSharedPointer<MatrixClient> client_;
 
-        using UserID = QString;
-        static QMap<UserID, AvatarData> avatars_;
-        static QMap<UserID, QList<TimelineItem *>> toBeResolved_;
+        using UserID = Identifier;
+        static QHash<UserID, AvatarData> avatars_;
+        // Timeline items waiting for an avatar. They can be destroyed before
+        // the avatar arrives, e.g when they scroll out of view.
+        static QHash<UserID, QList<QPointer<TimelineItem>>> toBeResolved_;
 };
@@ -19,13 +19,15 @@
 
 #include <QFrame>
 #include <QHBoxLayout>
+#include <QImage>
 #include <QMap>
-#include <QPixmap>
 #include <QTimer>
 #include <QWidget>
 
 #include <mtx.hpp>
 
+#include "Identifier.h"
+
 class Cache;
 class MatrixClient;
 class OverlayModal;
@@ -41,7 +43,6 @@ class TopRoomBar;
 class TypingDisplay;
 class UserInfoWidget;
 
-constexpr int CONSENSUS_TIMEOUT      = 1000;
 constexpr int SHOW_CONTENT_TIMEOUT   = 3000;
 constexpr int TYPING_REFRESH_TIMEOUT = 10000;
 
@@ -68,10 +69,10 @@ signals:
 
 private slots:
         void showUnreadMessageNotification(int count);
-        void updateTopBarAvatar(const QString &roomid, const QPixmap &img);
+        void updateTopBarAvatar(const QString &roomid, const QImage &img);
         void updateOwnProfileInfo(const QUrl &avatar_url, const QString &display_name);
-        void setOwnAvatar(const QPixmap &img);
-        void initialSyncCompleted(const mtx::responses::Sync &response);
+        void setOwnAvatar(const QImage &img);
+        void initialSyncCompleted(QSharedPointer<mtx::responses::Sync> response);
         void syncCompleted(const mtx::responses::Sync &response);
         void syncFailed(const QString &msg);
         void changeTopRoomInfo(const QString &room_id);
@@ -83,13 +84,14 @@ private:
         using UserID      = QString;
         using RoomStates  = QMap<UserID, RoomState>;
         using Membership  = mtx::events::StateEvent<mtx::events::state::Member>;
-        using Memberships = std::map<std::string, Membership>;
+        using Memberships = std::map<Identifier, Membership, Identifier::HandleOrder>;
 
         using JoinedRooms = std::map<std::string, mtx::responses::JoinedRoom>;
         using LeftRooms   = std::map<std::string, mtx::responses::LeftRoom>;
 
         void removeLeftRooms(const LeftRooms &rooms);
-        void updateJoinedRooms(const JoinedRooms &rooms);
+        // Returns the rooms whose room list entry has to be updated.
+        QList<QString> updateJoinedRooms(const JoinedRooms &rooms);
 
         RoomStates generateMembershipDifference(const JoinedRooms &rooms,
                                                 const RoomStates &states) const;
@@ -101,6 +103,9 @@ private:
         void updateUserAvatarUrl(const MemberEvent &event);
 
         void loadStateFromCache();
+        // Complete the state of a room of the initial sync, once its state
+        // events have been applied.
+        void resolveJoinedRoomState(const QString &room_id, const mtx::responses::JoinedRoom &room);
         void deleteConfigs();
         void resetUI();
 
@@ -127,12 +132,12 @@ private:
         TextInputWidget *text_input_;
         TypingDisplay *typingDisplay_;
 
-        // Safety net if consensus is not possible or too slow.
+        // Safety net if the timeline of the selected room is too slow to load.
+        // It's active while the content is waiting for that timeline.
         QTimer *showContentTimer_;
-        QTimer *consensusTimer_;
 
         QString current_room_;
-        QMap<QString, QPixmap> room_avatars_;
+        QMap<QString, QImage> room_avatars_;
 
         UserInfoWidget *user_info_widget_;
 
@@ -165,7 +170,7 @@ ChatPage::updateUserMetadata(const std::vector<Collection> &collection)
 
         for (auto &event : collection) {
                 if (mpark::holds_alternative<Member>(event)) {
-                        auto member = mpark::get<Member>(event);
+                        const auto &member = mpark::get<Member>(event);
 
                         updateUserAvatarUrl(member);
                         updateUserDisplayName(member);
@@ -174,17 +179,17 @@ ChatPage::updateUserMetadata(const std::vector<Collection> &collection)
 }
 
 template<class Collection>
-std::map<std::string, mtx::events::StateEvent<mtx::events::state::Member>>
+ChatPage::Memberships
 ChatPage::getMemberships(const std::vector<Collection> &collection) const
 {
-        std::map<std::string, mtx::events::StateEvent<mtx::events::state::Member>> memberships;
+        Memberships memberships;
 
         using Member = mtx::events::StateEvent<mtx::events::state::Member>;
 
         for (auto &event : collection) {
                 if (mpark::holds_alternative<Member>(event)) {
-                        auto member = mpark::get<Member>(event);
-                        memberships.emplace(member.state_key, member);
+                        const auto &member = mpark::get<Member>(event);
+                        memberships.emplace(Identifier(member.state_key), member);
                 }
         }
 
@@ -38,6 +38,8 @@ static constexpr int cornerRadius = 3;
 
 // RoomList specific.
 namespace roomlist {
+static constexpr int avatarSize = 48;
+
 namespace fonts {
 static constexpr int heading = 13;
 static constexpr int badge   = 10;
@@ -46,6 +48,8 @@ static constexpr int bubble  = 20;
 } // namespace roomlist
 
 namespace userInfoWidget {
+static constexpr int avatarSize = 55;
+
 namespace fonts {
 static constexpr int displayName = 16;
 static constexpr int userid      = 14;
@@ -0,0 +1,79 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <mtx.hpp>
+
+/*
+ * Routes the active alternative of an event collection (e.g
+ * mtx::events::collections::TimelineEvents) to a handler.
+ *
+ * A handler is a class with a `result_type`, an `operator()` overload for
+ * every event type it is interested in and a `fallback()` for the rest.
+ * Events are passed by reference and the alternative is selected by the
+ * variant index through a jump table, instead of testing each type in turn.
+ *
+ *      struct SenderOf
+ *      {
+ *              using result_type = std::string;
+ *
+ *              std::string operator()(const TextEvent &e) const { return e.sender; }
+ *              std::string fallback() const { return ""; }
+ *      };
+ *
+ *      auto sender = dispatch::visit(SenderOf{}, event);
+ */
+namespace dispatch {
+namespace detail {
+
+// Preferred (int) when the handler accepts the event, otherwise the
+// conversion to long selects the fallback.
+template<class Handler, class Event>
+auto
+call(const Handler &handler, const Event &event, int) -> decltype(handler(event))
+{
+        return handler(event);
+}
+
+template<class Handler, class Event>
+auto
+call(const Handler &handler, const Event &, long) -> decltype(handler.fallback())
+{
+        return handler.fallback();
+}
+
+template<class Handler>
+struct Visitor
+{
+        const Handler &handler;
+
+        template<class Event>
+        typename Handler::result_type operator()(const Event &event) const
+        {
+                return call(handler, event, 0);
+        }
+};
+}
+
+template<class Handler, class Collection>
+typename Handler::result_type
+visit(const Handler &handler, const Collection &event)
+{
+        return mpark::visit(detail::Visitor<Handler>{handler}, event);
+}
+}
@@ -0,0 +1,78 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <QHash>
+#include <QString>
+
+/*
+ * A handle to an interned Matrix identifier, e.g a user id.
+ *
+ * Every distinct identifier is stored once, together with its QString
+ * representation. The table is never freed, so handles stay valid for the
+ * lifetime of the application. Handles are a single pointer, so they can be
+ * copied, compared and hashed in O(1) and every QString returned by
+ * toString() shares the same buffer.
+ */
+class Identifier
+{
+public:
+        Identifier() = default;
+        explicit Identifier(const std::string &id);
+        explicit Identifier(const QString &id);
+
+        const std::string &toStdString() const;
+        const QString &toString() const;
+
+        bool isEmpty() const { return entry_ == nullptr; }
+
+        bool operator==(const Identifier &other) const { return entry_ == other.entry_; }
+        bool operator!=(const Identifier &other) const { return entry_ != other.entry_; }
+
+        // Ordered by the identifier itself, so ordered containers iterate in
+        // the same order as they would with strings.
+        bool operator<(const Identifier &other) const;
+
+        // Orders the handles without comparing the strings. The order is
+        // arbitrary, so it's meant for containers whose order has no meaning.
+        struct HandleOrder
+        {
+                bool operator()(const Identifier &a, const Identifier &b) const
+                {
+                        return std::less<const Entry *>()(a.entry_, b.entry_);
+                }
+        };
+
+        friend uint qHash(const Identifier &id, uint seed = 0)
+        {
+                return ::qHash(static_cast<const void *>(id.entry_), seed);
+        }
+
+private:
+        struct Entry;
+        struct Table;
+
+        static Table &table();
+        static const Entry *intern(const std::string &id);
+        static const Entry *intern(const QString &id);
+
+        const Entry *entry_ = nullptr;
+};
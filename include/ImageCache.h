@@ -0,0 +1,56 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+/*
+ * ImageCache holds images already scaled for display, shared between the
+ * timeline and the image overlay. Entries are keyed by the media they were
+ * created from, the box they were fitted into and the device pixel ratio.
+ * The least recently used entries are dropped once the byte budget is
+ * exceeded. It should only be used from the GUI thread.
+ */
+class ImageCache
+{
+public:
+        // Budget for all the cached pixmaps in KiB.
+        static constexpr int MaxCost = 64 * 1024;
+
+        // Returns a null pixmap if the media hasn't been fitted in that box.
+        static QPixmap find(const QString &mediaId, const QSize &box, qreal pixelRatio);
+
+        // Scale the image to fit in `box` logical pixels, keeping its aspect
+        // ratio, and cache the result. Images that already fit in the box's
+        // device pixels keep their own pixels. Media without an id are scaled
+        // but not cached.
+        static QPixmap fitted(const QString &mediaId,
+                              const QPixmap &image,
+                              const QSize &box,
+                              qreal pixelRatio);
+
+        static void clear();
+
+private:
+        static QString key(const QString &mediaId, const QSize &box, qreal pixelRatio);
+
+        static QCache<QString, QPixmap> pixmaps_;
+};
@@ -17,8 +17,13 @@
 
 #pragma once
 
+#include <functional>
+
 #include <QFileInfo>
+#include <QImage>
 #include <QNetworkAccessManager>
+#include <QPointer>
+#include <QSharedPointer>
 #include <QUrl>
 #include <mtx.hpp>
 
@@ -30,6 +35,11 @@ class MatrixClient : public QNetworkAccessManager
 {
         Q_OBJECT
 public:
+        // Completion handlers for requests made on behalf of a single object.
+        using ImageCallback    = std::function<void(const QImage &)>;
+        using FileCallback     = std::function<void(const QByteArray &)>;
+        using MessagesCallback = std::function<void(const mtx::responses::Messages &)>;
+
         MatrixClient(QString server, QObject *parent = 0);
 
         // Client API.
@@ -49,9 +59,23 @@ public:
         void fetchRoomAvatar(const QString &roomid, const QUrl &avatar_url);
         void fetchUserAvatar(const QString &userId, const QUrl &avatarUrl);
         void fetchOwnAvatar(const QUrl &avatar_url);
-        void downloadImage(const QString &event_id, const QUrl &url);
-        void downloadFile(const QString &event_id, const QUrl &url);
-        void messages(const QString &room_id, const QString &from_token, int limit = 30) noexcept;
+
+        // Media and pagination results are delivered only to the receiver
+        // that made the request, instead of being broadcast. The callback is
+        // dropped if the receiver is destroyed before the reply arrives.
+        void downloadImage(const QUrl &url, QObject *receiver, ImageCallback callback);
+        // The thumbnail is decoded to fit in `size` logical pixels.
+        void downloadThumbnail(const QUrl &url,
+                               const QSize &size,
+                               QObject *receiver,
+                               ImageCallback callback);
+        void downloadFile(const QUrl &url, QObject *receiver, FileCallback callback);
+        void messages(const QString &room_id,
+                      const QString &from_token,
+                      QObject *receiver,
+                      MessagesCallback callback,
+                      int limit = 30) noexcept;
+
         void uploadImage(const QString &roomid, const QString &filename);
         void uploadFile(const QString &roomid, const QString &filename);
         void uploadAudio(const QString &roomid, const QString &filename);
@@ -62,8 +86,7 @@ public:
         void readEvent(const QString &room_id, const QString &event_id);
 
         QUrl getHomeServer() { return server_; };
-        int transactionId() { return txn_id_; };
-        int incrementTransactionId() { return ++txn_id_; };
+        int incrementTransactionId();
 
         void reset() noexcept;
 
@@ -94,15 +117,13 @@ signals:
         void fileUploaded(const QString &roomid, const QString &filename, const QString &url);
         void audioUploaded(const QString &roomid, const QString &filename, const QString &url);
 
-        void roomAvatarRetrieved(const QString &roomid, const QPixmap &img);
+        void roomAvatarRetrieved(const QString &roomid, const QImage &img);
         void userAvatarRetrieved(const QString &userId, const QImage &img);
-        void ownAvatarRetrieved(const QPixmap &img);
-        void imageDownloaded(const QString &event_id, const QPixmap &img);
-        void fileDownloaded(const QString &event_id, const QByteArray &data);
+        void ownAvatarRetrieved(const QImage &img);
 
         // Returned profile data for the user's account.
         void getOwnProfileResponse(const QUrl &avatar_url, const QString &display_name);
-        void initialSyncCompleted(const mtx::responses::Sync &response);
+        void initialSyncCompleted(QSharedPointer<mtx::responses::Sync> response);
         void initialSyncFailed(const QString &msg);
         void syncCompleted(const mtx::responses::Sync &response);
         void syncFailed(const QString &msg);
@@ -110,13 +131,27 @@ signals:
         void messageSent(const QString &event_id, const QString &roomid, const int txn_id);
         void messageSendFailed(const QString &roomid, const int txn_id);
         void emoteSent(const QString &event_id, const QString &roomid, const int txn_id);
-        void messagesRetrieved(const QString &room_id, const mtx::responses::Messages &msgs);
         void joinedRoom(const QString &room_id);
         void leftRoom(const QString &room_id);
 
 private:
         QNetworkReply *makeUploadRequest(const QString &filename);
 
+        // Server side thumbnail for an avatar displayed at `size` logical pixels.
+        QUrl avatarThumbnailUrl(const QUrl &avatar_url, int size) const;
+
+        // Decode the image on the decoder thread pool, scaled down to fit in
+        // `size` logical pixels. The callback is invoked on the GUI thread,
+        // only if the image could be decoded and the receiver still exists.
+        void decodeImage(const QByteArray &data,
+                         const QSize &size,
+                         QObject *receiver,
+                         ImageCallback callback);
+
+        // Abort the request if the receiver of its reply is destroyed before
+        // it is finished, e.g a timeline item that was scrolled past.
+        void abortWithReceiver(QNetworkReply *reply, QObject *receiver);
+
         // Client API prefix.
         QString clientApiUrl_;
 
@@ -129,9 +164,6 @@ private:
         // The access token used for authentication.
         QString token_;
 
-        // Increasing transaction ID.
-        int txn_id_;
-
         // Token to be used for the next sync.
         QString next_batch_;
 };
@@ -24,6 +24,9 @@
 
 #include "TextField.h"
 
+class QStringListModel;
+class RoomSearchIndex;
+
 class RoomSearchInput : public TextField
 {
         Q_OBJECT
@@ -45,9 +48,9 @@ class QuickSwitcher : public QFrame
 {
         Q_OBJECT
 public:
-        explicit QuickSwitcher(QWidget *parent = nullptr);
-
-        void setRoomList(const QMap<QString, QString> &rooms);
+        // The index is searched on every keystroke, so it isn't copied and
+        // has to outlive the switcher.
+        QuickSwitcher(const RoomSearchIndex *index, QWidget *parent = nullptr);
 
 signals:
         void closing();
@@ -58,12 +61,21 @@ protected:
         void showEvent(QShowEvent *event) override;
 
 private:
+        // Maximum number of rooms displayed.
+        static constexpr int MaxResults = 20;
+
+        void search(const QString &query);
+
         // Current highlighted selection from the completer.
         int selection_ = -1;
 
         QVBoxLayout *topLayout_;
         RoomSearchInput *roomSearch_;
         QCompleter *completer_;
+        QStringListModel *results_;
+
+        const RoomSearchIndex *index_;
 
-        QMap<QString, QString> rooms_;
+        // The room ids of the displayed results.
+        QStringList roomIds_;
 };
@@ -17,15 +17,14 @@
 
 #pragma once
 
-#include <QAction>
-#include <QSharedPointer>
-#include <QWidget>
+#include <QDateTime>
+#include <QImage>
+#include <QPixmap>
+#include <QStyledItemDelegate>
 
-#include "RoomState.h"
+#include "Config.h"
 
-class Menu;
-class RippleOverlay;
-class RoomSettings;
+class RoomListView;
 
 struct DescInfo
 {
@@ -33,118 +32,34 @@ struct DescInfo
         QString userid;
         QString body;
         QString timestamp;
+        // When the message was sent, used to order the rooms by activity.
+        QDateTime datetime;
 };
 
-class RoomInfoListItem : public QWidget
+/*
+ * Paints the rows of the room list. There are no per room widgets, so only
+ * the visible rows cost anything. The colors are taken from the view, which
+ * is styled through the stylesheet.
+ */
+class RoomInfoListItem : public QStyledItemDelegate
 {
         Q_OBJECT
-        Q_PROPERTY(QColor highlightedBackgroundColor READ highlightedBackgroundColor WRITE
-                     setHighlightedBackgroundColor)
-        Q_PROPERTY(
-          QColor hoverBackgroundColor READ hoverBackgroundColor WRITE setHoverBackgroundColor)
-        Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor)
-
-        Q_PROPERTY(QColor titleColor READ titleColor WRITE setTitleColor)
-        Q_PROPERTY(QColor subtitleColor READ subtitleColor WRITE setSubtitleColor)
-
-        Q_PROPERTY(
-          QColor highlightedTitleColor READ highlightedTitleColor WRITE setHighlightedTitleColor)
-        Q_PROPERTY(QColor highlightedSubtitleColor READ highlightedSubtitleColor WRITE
-                     setHighlightedSubtitleColor)
 
 public:
-        RoomInfoListItem(QSharedPointer<RoomSettings> settings,
-                         RoomState state,
-                         QString room_id,
-                         QWidget *parent = 0);
-
-        ~RoomInfoListItem();
-
-        void updateUnreadMessageCount(int count);
-        void clearUnreadMessageCount();
-        void setState(const RoomState &state);
-
-        bool isPressed() const { return isPressed_; }
-        RoomState state() const { return state_; }
-        int unreadMessageCount() const { return unreadMsgCount_; }
-
-        void setAvatar(const QImage &avatar_image);
-        void setDescriptionMessage(const DescInfo &info);
-
-        inline QColor highlightedBackgroundColor() const { return highlightedBackgroundColor_; }
-        inline QColor hoverBackgroundColor() const { return hoverBackgroundColor_; }
-        inline QColor backgroundColor() const { return backgroundColor_; }
-
-        inline QColor highlightedTitleColor() const { return highlightedTitleColor_; }
-        inline QColor highlightedSubtitleColor() const { return highlightedSubtitleColor_; }
-
-        inline QColor titleColor() const { return titleColor_; }
-        inline QColor subtitleColor() const { return subtitleColor_; }
-
-        inline void setHighlightedBackgroundColor(QColor &color)
-        {
-                highlightedBackgroundColor_ = color;
-        }
-        inline void setHoverBackgroundColor(QColor &color) { hoverBackgroundColor_ = color; }
-        inline void setBackgroundColor(QColor &color) { backgroundColor_ = color; }
-
-        inline void setHighlightedTitleColor(QColor &color) { highlightedTitleColor_ = color; }
-        inline void setHighlightedSubtitleColor(QColor &color)
-        {
-                highlightedSubtitleColor_ = color;
-        }
-
-        inline void setTitleColor(QColor &color) { titleColor_ = color; }
-        inline void setSubtitleColor(QColor &color) { subtitleColor_ = color; }
+        static constexpr int Padding  = 7;
+        static constexpr int IconSize = conf::roomlist::avatarSize;
+        static constexpr int Height   = IconSize + 2 * Padding;
 
-signals:
-        void clicked(const QString &room_id);
-        void leaveRoom(const QString &room_id);
+        explicit RoomInfoListItem(RoomListView *view);
 
-public slots:
-        void setPressedState(bool state);
+        void paint(QPainter *painter,
+                   const QStyleOptionViewItem &option,
+                   const QModelIndex &index) const override;
+        QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
-protected:
-        void mousePressEvent(QMouseEvent *event) override;
-        void paintEvent(QPaintEvent *event) override;
-        void resizeEvent(QResizeEvent *event) override;
-        void contextMenuEvent(QContextMenuEvent *event) override;
+        // Render a room avatar once into a circular pixmap ready to be painted.
+        static QPixmap avatarPixmap(const QImage &img, qreal pixelRatio);
 
 private:
-        QString notificationText();
-
-        const int Padding  = 7;
-        const int IconSize = 48;
-
-        RippleOverlay *ripple_overlay_;
-
-        RoomState state_;
-
-        QString roomId_;
-        QString roomName_;
-
-        DescInfo lastMsgInfo_;
-
-        QPixmap roomAvatar_;
-
-        Menu *menu_;
-        QAction *toggleNotifications_;
-        QAction *leaveRoom_;
-
-        QSharedPointer<RoomSettings> roomSettings_;
-
-        bool isPressed_ = false;
-
-        int maxHeight_;
-        int unreadMsgCount_ = 0;
-
-        QColor highlightedBackgroundColor_;
-        QColor hoverBackgroundColor_;
-        QColor backgroundColor_;
-
-        QColor highlightedTitleColor_;
-        QColor highlightedSubtitleColor_;
-
-        QColor titleColor_;
-        QColor subtitleColor_;
+        RoomListView *view_;
 };
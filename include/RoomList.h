@@ -19,7 +19,6 @@
 
 #include <QMap>
 #include <QPushButton>
-#include <QScrollArea>
 #include <QSharedPointer>
 #include <QVBoxLayout>
 #include <QWidget>
@@ -29,7 +28,9 @@
 class LeaveRoomDialog;
 class MatrixClient;
 class OverlayModal;
-class RoomInfoListItem;
+class RoomListModel;
+class RoomListView;
+class RoomSearchIndex;
 class RoomSettings;
 class RoomState;
 class Sync;
@@ -44,8 +45,12 @@ public:
         ~RoomList();
 
         void setInitialRooms(const QMap<QString, QSharedPointer<RoomSettings>> &settings,
-                             const QMap<QString, RoomState> &states);
+                             const QMap<QString, RoomState> &states,
+                             const QMap<QString, DescInfo> &lastMessages);
+        // Update the entries of the given rooms, adding the ones that are
+        // not in the list yet. The rest of the rooms are left untouched.
         void sync(const QMap<QString, RoomState> &states,
+                  const QList<QString> &changedRooms,
                   QMap<QString, QSharedPointer<RoomSettings>> &settings);
 
         void clear();
@@ -55,12 +60,15 @@ public:
                      const QString &room_id);
         void removeRoom(const QString &room_id, bool reset);
 
+        // Search index of the rooms in the list.
+        const RoomSearchIndex &searchIndex() const;
+
 signals:
         void roomChanged(const QString &room_id);
         void totalUnreadMessageCountUpdated(int count);
 
 public slots:
-        void updateRoomAvatar(const QString &roomid, const QPixmap &img);
+        void updateRoomAvatar(const QString &roomid, const QImage &img);
         void highlightSelectedRoom(const QString &room_id);
         void updateUnreadMessageCount(const QString &roomid, int count);
         void updateRoomDescription(const QString &roomid, const DescInfo &info);
@@ -73,12 +81,15 @@ protected:
         void paintEvent(QPaintEvent *event) override;
 
 private:
-        void calculateUnreadMessageCount();
+        void updateTotalUnreadMessageCount(int diff);
+        void selectFirstRoom();
 
         QVBoxLayout *topLayout_;
-        QVBoxLayout *contentsLayout_;
-        QScrollArea *scrollArea_;
-        QWidget *scrollAreaContents_;
+
+        // The rooms are painted by a delegate, so there are no widgets per
+        // room and only the visible rows are painted.
+        RoomListView *view_;
+        RoomListModel *model_;
 
         QPushButton *joinRoomButton_;
 
@@ -87,7 +98,8 @@ private:
         QSharedPointer<OverlayModal> leaveRoomModal_;
         QSharedPointer<dialogs::LeaveRoom> leaveRoomDialog_;
 
-        QMap<QString, QSharedPointer<RoomInfoListItem>> rooms_;
+        // Sum of the unread messages of all rooms.
+        int totalUnreadMessageCount_ = 0;
 
         QSharedPointer<MatrixClient> client_;
 };
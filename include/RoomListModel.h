@@ -0,0 +1,127 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPixmap>
+#include <QSharedPointer>
+
+#include "RoomInfoListItem.h"
+#include "RoomSearchIndex.h"
+#include "RoomState.h"
+
+class RoomSettings;
+
+struct RoomListEntry
+{
+        QString roomId;
+        RoomState state;
+        DescInfo lastMessage;
+        QPixmap avatar;
+        QSharedPointer<RoomSettings> settings;
+        int unreadCount = 0;
+        // Whether the avatar at the current url has been asked for.
+        bool avatarRequested = false;
+};
+
+/*
+ * RoomListModel holds the rooms displayed in the room list, ordered by
+ * activity. Rooms with unread messages are pinned to the top and the rest
+ * follow with the most recently active first.
+ *
+ * The rows are kept sorted, so a room is found with a binary search on its
+ * sort key and an update only moves the affected row to its new position,
+ * instead of sorting the whole list again.
+ */
+class RoomListModel : public QAbstractListModel
+{
+        Q_OBJECT
+
+public:
+        enum Roles
+        {
+                RoomIdRole = Qt::UserRole,
+        };
+
+        explicit RoomListModel(QObject *parent = nullptr);
+
+        int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+        QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+        // Replace all the rooms with a single reset.
+        void setRooms(std::vector<RoomListEntry> rooms);
+        void addRoom(RoomListEntry room);
+        void removeRoom(const QString &roomId);
+        void clear();
+
+        bool contains(const QString &roomId) const { return keys_.contains(roomId); }
+        QModelIndex indexOf(const QString &roomId) const;
+
+        // Returns nullptr if the room isn't in the list.
+        const RoomListEntry *room(const QString &roomId) const;
+        const RoomListEntry &room(int row) const { return rooms_[row]; }
+
+        // Kept up to date with the rooms of the model.
+        const RoomSearchIndex &searchIndex() const { return searchIndex_; }
+
+        // Avatars are fetched lazily, the first time their row is painted.
+        // Emits avatarRequested once per avatar url.
+        void requestAvatar(int row);
+
+        void setState(const QString &roomId, const RoomState &state);
+        void setAvatar(const QString &roomId, const QPixmap &avatar);
+        void setLastMessage(const QString &roomId, const DescInfo &info);
+        void addUnreadCount(const QString &roomId, int count);
+        // Returns the number of unread messages that have been cleared.
+        int clearUnreadCount(const QString &roomId);
+
+signals:
+        void avatarRequested(const QString &roomId, const QUrl &url);
+
+private:
+        struct SortKey
+        {
+                bool pinned;
+                qint64 lastActivity;
+                QString roomId;
+
+                bool operator<(const SortKey &other) const;
+        };
+
+        static SortKey sortKey(const RoomListEntry &room);
+
+        // Position of the first room not sorted before `key` in [first, last).
+        int lowerBound(const SortKey &key, int first, int last) const;
+        // Returns -1 if the room isn't in the list.
+        int rowOf(const QString &roomId) const;
+        RoomListEntry *find(const QString &roomId);
+        // Move the room to its new position, if its sort key has changed,
+        // and repaint it.
+        void roomChanged(const QString &roomId);
+        void updateKeys();
+
+        std::vector<RoomListEntry> rooms_;
+
+        // The key each room is currently sorted by.
+        QHash<QString, SortKey> keys_;
+
+        RoomSearchIndex searchIndex_;
+};
@@ -0,0 +1,109 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QAction>
+#include <QListView>
+
+class Menu;
+class RippleOverlay;
+
+/*
+ * The list of joined rooms. Rows are painted by RoomInfoListItem from a
+ * RoomListModel. The ripple effect, the context menu and its actions are
+ * shared by all the rows.
+ */
+class RoomListView : public QListView
+{
+        Q_OBJECT
+        Q_PROPERTY(QColor highlightedBackgroundColor READ highlightedBackgroundColor WRITE
+                     setHighlightedBackgroundColor)
+        Q_PROPERTY(
+          QColor hoverBackgroundColor READ hoverBackgroundColor WRITE setHoverBackgroundColor)
+        Q_PROPERTY(QColor backgroundColor READ backgroundColor WRITE setBackgroundColor)
+
+        Q_PROPERTY(QColor titleColor READ titleColor WRITE setTitleColor)
+        Q_PROPERTY(QColor subtitleColor READ subtitleColor WRITE setSubtitleColor)
+
+        Q_PROPERTY(
+          QColor highlightedTitleColor READ highlightedTitleColor WRITE setHighlightedTitleColor)
+        Q_PROPERTY(QColor highlightedSubtitleColor READ highlightedSubtitleColor WRITE
+                     setHighlightedSubtitleColor)
+
+public:
+        explicit RoomListView(QWidget *parent = nullptr);
+
+        inline QColor highlightedBackgroundColor() const { return highlightedBackgroundColor_; }
+        inline QColor hoverBackgroundColor() const { return hoverBackgroundColor_; }
+        inline QColor backgroundColor() const { return backgroundColor_; }
+
+        inline QColor highlightedTitleColor() const { return highlightedTitleColor_; }
+        inline QColor highlightedSubtitleColor() const { return highlightedSubtitleColor_; }
+
+        inline QColor titleColor() const { return titleColor_; }
+        inline QColor subtitleColor() const { return subtitleColor_; }
+
+        inline void setHighlightedBackgroundColor(QColor &color)
+        {
+                highlightedBackgroundColor_ = color;
+        }
+        inline void setHoverBackgroundColor(QColor &color) { hoverBackgroundColor_ = color; }
+        inline void setBackgroundColor(QColor &color) { backgroundColor_ = color; }
+
+        inline void setHighlightedTitleColor(QColor &color) { highlightedTitleColor_ = color; }
+        inline void setHighlightedSubtitleColor(QColor &color)
+        {
+                highlightedSubtitleColor_ = color;
+        }
+
+        inline void setTitleColor(QColor &color) { titleColor_ = color; }
+        inline void setSubtitleColor(QColor &color) { subtitleColor_ = color; }
+
+        // Select the room's row and scroll to it.
+        void setSelectedRoom(const QModelIndex &index);
+
+signals:
+        void roomClicked(const QString &room_id);
+        void leaveRoom(const QString &room_id);
+
+protected:
+        void mousePressEvent(QMouseEvent *event) override;
+        void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+        QString notificationText(const QModelIndex &index) const;
+
+        RippleOverlay *ripple_overlay_;
+
+        Menu *menu_;
+        QAction *toggleNotifications_;
+        QAction *leaveRoom_;
+
+        // The row the context menu has been opened for.
+        QPersistentModelIndex menuIndex_;
+
+        QColor highlightedBackgroundColor_;
+        QColor hoverBackgroundColor_;
+        QColor backgroundColor_;
+
+        QColor highlightedTitleColor_;
+        QColor highlightedSubtitleColor_;
+
+        QColor titleColor_;
+        QColor subtitleColor_;
+};
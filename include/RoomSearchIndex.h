@@ -0,0 +1,85 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class RoomState;
+
+struct RoomSearchResult
+{
+        QString roomId;
+        QString name;
+        // The canonical alias or the room id, used to tell apart rooms with
+        // the same name.
+        QString deambiguator;
+};
+
+/*
+ * RoomSearchIndex finds rooms by fuzzy matching a query against their name,
+ * aliases and, for direct chats, the display names of the other members.
+ *
+ * The searchable terms are case folded once when a room is added or its state
+ * changes, so a search only compares characters. A query that extends the
+ * previous one is only matched against the rooms that matched before.
+ */
+class RoomSearchIndex
+{
+public:
+        // Add the room or update its terms.
+        void insert(const QString &roomId, const RoomState &state);
+        void remove(const QString &roomId);
+        void clear();
+
+        // Used to rank the rooms with equally good matches.
+        void setLastActivity(const QString &roomId, qint64 lastActivity);
+
+        // At most `limit` rooms matching the query, best match first.
+        std::vector<RoomSearchResult> search(const QString &query, int limit) const;
+
+private:
+        struct Entry
+        {
+                QString roomId;
+                QString name;
+                QString deambiguator;
+                // Case folded; the room name comes first.
+                QStringList terms;
+                // The characters that appear in any of the terms.
+                quint64 characters;
+                qint64 lastActivity;
+        };
+
+        static quint64 characterMask(const QString &text);
+        static int matchScore(const QString &term, const QString &query);
+
+        void invalidate();
+
+        std::vector<Entry> entries_;
+
+        // Position of each room in entries_.
+        QHash<QString, std::size_t> positions_;
+
+        // The last query and the rooms that matched it.
+        mutable QString lastQuery_;
+        mutable std::vector<std::size_t> lastMatches_;
+};
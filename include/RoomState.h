@@ -17,12 +17,92 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include <QJsonDocument>
 #include <QPixmap>
+#include <QSharedData>
 #include <QUrl>
 
 #include <mtx.hpp>
 
+#include "EventDispatch.h"
+#include "Identifier.h"
+
+// The m.room.member events of a room, keyed by user id. The members are
+// ordered by handle, so lookups don't compare the user ids.
+//
+// The events are implicitly shared, so copying a RoomState is O(1) regardless
+// of the number of members. The map is copied only when a shared instance is
+// modified.
+class RoomMembers
+{
+public:
+        using Member         = mtx::events::StateEvent<mtx::events::state::Member>;
+        using Map            = std::map<Identifier, Member, Identifier::HandleOrder>;
+        using const_iterator = Map::const_iterator;
+
+        RoomMembers()
+          : d(new Data)
+        {}
+        RoomMembers(Map members)
+          : d(new Data)
+        {
+                d->members = std::move(members);
+        }
+
+        const_iterator begin() const { return d->members.cbegin(); }
+        const_iterator end() const { return d->members.cend(); }
+        const_iterator cbegin() const { return d->members.cbegin(); }
+        const_iterator cend() const { return d->members.cend(); }
+        const_iterator find(const Identifier &user_id) const { return d->members.find(user_id); }
+
+        std::size_t size() const { return d->members.size(); }
+        std::size_t count(const Identifier &user_id) const { return d->members.count(user_id); }
+        bool empty() const { return d->members.empty(); }
+
+        // Whether both instances refer to the same member events without
+        // comparing them.
+        bool isSharedWith(const RoomMembers &other) const { return d == other.d; }
+
+        bool emplace(const Identifier &user_id, const Member &member)
+        {
+                return d->members.emplace(user_id, member).second;
+        }
+        std::size_t erase(const Identifier &user_id) { return d->members.erase(user_id); }
+
+        template<class Predicate>
+        void removeIf(Predicate predicate);
+
+private:
+        struct Data : public QSharedData
+        {
+                Map members;
+        };
+
+        QSharedDataPointer<Data> d;
+};
+
+template<class Predicate>
+void
+RoomMembers::removeIf(Predicate predicate)
+{
+        // Avoid detaching from the shared map when there is nothing to remove.
+        if (std::none_of(cbegin(), cend(), [&predicate](const Map::value_type &member) {
+                    return predicate(member.second);
+            }))
+                return;
+
+        auto &members = d->members;
+
+        for (auto it = members.begin(); it != members.end();) {
+                if (predicate(it->second))
+                        it = members.erase(it);
+                else
+                        ++it;
+        }
+}
+
 class RoomState
 {
 public:
@@ -50,9 +130,17 @@ public:
 
         template<class Collection>
         void updateFromEvents(const std::vector<Collection> &collection);
+        // Apply the events in [first, last), e.g to split a large state.
+        template<class Iterator>
+        void updateFromEvents(Iterator first, Iterator last);
 
         std::string serialize() const;
 
+        // Every modification takes a new value from a process wide sequence,
+        // so two states with the same version are copies of each other.
+        // Events other than state events leave it unchanged.
+        quint64 version() const { return version_; }
+
         // The latest state events.
         mtx::events::StateEvent<mtx::events::state::Aliases> aliases;
         mtx::events::StateEvent<mtx::events::state::Avatar> avatar;
@@ -65,55 +153,67 @@ public:
         mtx::events::StateEvent<mtx::events::state::Topic> topic;
 
         // Contains the m.room.member events for all the joined users.
-        using UserID = std::string;
-        std::map<UserID, mtx::events::StateEvent<mtx::events::state::Member>> memberships;
+        RoomMembers memberships;
 
 private:
+        // Applies a single state event to the room state. Events of other
+        // types are ignored and return false.
+        struct EventUpdater
+        {
+                using result_type = bool;
+
+                template<class Content>
+                using StateEvent = mtx::events::StateEvent<Content>;
+
+                bool operator()(const StateEvent<mtx::events::state::Aliases> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::Avatar> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::CanonicalAlias> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::Create> &event) const;
+                bool operator()(
+                  const StateEvent<mtx::events::state::HistoryVisibility> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::JoinRules> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::Member> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::Name> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::PowerLevels> &event) const;
+                bool operator()(const StateEvent<mtx::events::state::Topic> &event) const;
+
+                bool fallback() const { return false; }
+
+                RoomState &state;
+        };
+
+        static quint64 nextVersion();
+
+        quint64 version_ = 0;
+
         QUrl avatar_;
         QString name_;
 
         // It defines the user whose avatar is used for the room. If the room has an
         // avatar event this should be empty.
-        QString userAvatar_;
+        Identifier userAvatar_;
 };
 
 template<class Collection>
 void
 RoomState::updateFromEvents(const std::vector<Collection> &collection)
 {
-        using Aliases           = mtx::events::StateEvent<mtx::events::state::Aliases>;
-        using Avatar            = mtx::events::StateEvent<mtx::events::state::Avatar>;
-        using CanonicalAlias    = mtx::events::StateEvent<mtx::events::state::CanonicalAlias>;
-        using Create            = mtx::events::StateEvent<mtx::events::state::Create>;
-        using HistoryVisibility = mtx::events::StateEvent<mtx::events::state::HistoryVisibility>;
-        using JoinRules         = mtx::events::StateEvent<mtx::events::state::JoinRules>;
-        using Member            = mtx::events::StateEvent<mtx::events::state::Member>;
-        using Name              = mtx::events::StateEvent<mtx::events::state::Name>;
-        using PowerLevels       = mtx::events::StateEvent<mtx::events::state::PowerLevels>;
-        using Topic             = mtx::events::StateEvent<mtx::events::state::Topic>;
-
-        for (const auto &event : collection) {
-                if (mpark::holds_alternative<Aliases>(event)) {
-                        this->aliases = mpark::get<Aliases>(event);
-                } else if (mpark::holds_alternative<Avatar>(event)) {
-                        this->avatar = mpark::get<Avatar>(event);
-                } else if (mpark::holds_alternative<CanonicalAlias>(event)) {
-                        this->canonical_alias = mpark::get<CanonicalAlias>(event);
-                } else if (mpark::holds_alternative<Create>(event)) {
-                        this->create = mpark::get<Create>(event);
-                } else if (mpark::holds_alternative<HistoryVisibility>(event)) {
-                        this->history_visibility = mpark::get<HistoryVisibility>(event);
-                } else if (mpark::holds_alternative<JoinRules>(event)) {
-                        this->join_rules = mpark::get<JoinRules>(event);
-                } else if (mpark::holds_alternative<Name>(event)) {
-                        this->name = mpark::get<Name>(event);
-                } else if (mpark::holds_alternative<Member>(event)) {
-                        auto membership = mpark::get<Member>(event);
-                        this->memberships.emplace(membership.state_key, membership);
-                } else if (mpark::holds_alternative<PowerLevels>(event)) {
-                        this->power_levels = mpark::get<PowerLevels>(event);
-                } else if (mpark::holds_alternative<Topic>(event)) {
-                        this->topic = mpark::get<Topic>(event);
-                }
+        updateFromEvents(collection.cbegin(), collection.cend());
+}
+
+template<class Iterator>
+void
+RoomState::updateFromEvents(Iterator first, Iterator last)
+{
+        const EventUpdater updater{*this};
+
+        bool isModified = false;
+
+        for (auto it = first; it != last; ++it) {
+                if (dispatch::visit(updater, *it))
+                        isModified = true;
         }
+
+        if (isModified)
+                version_ = nextVersion();
 }
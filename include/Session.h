@@ -0,0 +1,78 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include "Identifier.h"
+
+/*
+ * In-memory copy of the login session (the auth/ and client/ settings).
+ *
+ * The values are read from QSettings once and are then served from memory, so
+ * they can be queried from hot paths like message rendering. New credentials
+ * are written back immediately. Transaction ids are reserved on disk in blocks
+ * before they are handed out, so an id is never reused after a crash.
+ */
+class Session : public QObject
+{
+        Q_OBJECT
+
+public:
+        static Session *instance();
+
+        // Store the credentials of a new login. The user id is fixed for the
+        // lifetime of the session: the timelines and the room list that cache
+        // it are torn down on logout and rebuilt after the next login.
+        void setLogin(const QString &user_id,
+                      const QString &home_server,
+                      const QString &access_token);
+        // Returns a transaction id that was never used by this session.
+        int nextTransactionId();
+
+        // Forget the current session.
+        void clear();
+
+        bool hasActiveUser() const;
+
+        const QString &userId() const { return userId_.toString(); }
+        // The interned user id, for cheap comparisons with event senders.
+        const Identifier &userIdentifier() const { return userId_; }
+        const QString &homeServer() const { return homeServer_; }
+        const QString &accessToken() const { return accessToken_; }
+
+public slots:
+        // Write the credentials and the last used transaction id to QSettings.
+        void flush();
+
+private:
+        explicit Session(QObject *parent = nullptr);
+
+        void load();
+
+        Identifier userId_;
+        QString homeServer_;
+        QString accessToken_;
+        // The last transaction id that was handed out.
+        int txnId_ = 1;
+        // The highest id stored in QSettings.
+        int reservedTxnId_ = 1;
+
+        bool isDirty_ = false;
+};
@@ -0,0 +1,104 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QWidget;
+
+/*
+ * Records named phases of the startup path with a monotonic clock.
+ *
+ * It is disabled unless nheko is started with one of:
+ *
+ *      --profile-startup       Log a breakdown of the phases after the first
+ *                              paint of the content.
+ *      --benchmark-startup     Print the phases as JSON on stdout after the
+ *                              first paint of the content and exit.
+ *
+ * When disabled every call is a no-op.
+ */
+class StartupProfiler : public QObject
+{
+        Q_OBJECT
+
+public:
+        enum class Mode
+        {
+                Disabled,
+                Report,
+                Benchmark,
+        };
+
+        // Scans the command line for the profiling flags and starts the clock.
+        // Should be called as early as possible in main().
+        static void init(int argc, char *argv[]);
+
+        static bool isEnabled() { return mode_ != Mode::Disabled; }
+
+        static void beginPhase(const QString &name);
+        static void endPhase(const QString &name);
+
+        // Records a point in time. e.g the first paint.
+        static void mark(const QString &name);
+
+        // Report the results after the next time the widget is painted.
+        static void finishOnPaint(QWidget *widget);
+
+        // Times the enclosing scope.
+        class Phase
+        {
+        public:
+                explicit Phase(const QString &name)
+                  : name_(name)
+                {
+                        beginPhase(name_);
+                }
+                ~Phase() { endPhase(name_); }
+
+        private:
+                QString name_;
+        };
+
+protected:
+        bool eventFilter(QObject *obj, QEvent *event) override;
+
+private:
+        explicit StartupProfiler(QObject *parent = nullptr);
+
+        static void finish();
+        static void printReport();
+        static void printJson();
+
+        struct Record
+        {
+                QString name;
+                qint64 start = -1;
+                qint64 end   = -1;
+                int depth    = 0;
+        };
+
+        static Mode mode_;
+        static bool isFinished_;
+        static int depth_;
+        static QElapsedTimer clock_;
+        static QList<Record> records_;
+};
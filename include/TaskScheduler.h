@@ -0,0 +1,92 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+/*
+ * TaskScheduler runs long jobs on the GUI thread in small chunks.
+ *
+ * Each event loop iteration executes chunks for at most `SliceBudget` ms and
+ * then returns to the event loop, so pending input and paint events are
+ * handled between slices without re-entering the event loop from the middle
+ * of an update.
+ */
+class TaskScheduler : public QObject
+{
+        Q_OBJECT
+
+public:
+        // A resumable unit of work. It should return true if there is more
+        // work to be done, in which case it will be called again.
+        using Chunk = std::function<bool()>;
+
+        // Maximum time in milliseconds spent on queued work per iteration.
+        static constexpr int SliceBudget = 8;
+
+        static TaskScheduler *instance();
+
+        // Queue a job. Jobs are executed in order. The job is discarded if
+        // the owner is destroyed before it is completed.
+        void schedule(QObject *owner, Chunk chunk);
+
+        // Discard all the pending jobs of the given owner.
+        void cancel(QObject *owner);
+
+        bool isIdle() const;
+
+        // Slice statistics, used to verify that the GUI thread isn't blocked
+        // for longer than the budget.
+        qint64 longestSlice() const { return longestSlice_; }
+        int overBudgetSlices() const { return overBudgetSlices_; }
+        int totalSlices() const { return totalSlices_; }
+
+private slots:
+        void runSlice();
+
+private:
+        explicit TaskScheduler(QObject *parent = nullptr);
+
+        struct Job
+        {
+                QPointer<QObject> owner;
+                Chunk chunk;
+        };
+
+        // Drops the jobs whose owner has been destroyed from the front of
+        // the queue. Returns false if no job is left.
+        bool hasNextJob();
+
+        std::deque<Job> queue_;
+
+        QTimer *timer_;
+
+        // The owner of the job currently executing and whether it has been
+        // cancelled while running.
+        QObject *runningOwner_   = nullptr;
+        bool isRunningCancelled_ = false;
+
+        qint64 longestSlice_  = 0;
+        int overBudgetSlices_ = 0;
+        int totalSlices_      = 0;
+};
@@ -35,9 +35,6 @@ class Menu;
 class OverlayModal;
 class RoomSettings;
 
-static const QString URL_HTML = "<a href=\"\\1\">\\1</a>";
-static const QRegExp URL_REGEX("((?:https?|ftp)://\\S+)");
-
 class TopRoomBar : public QWidget
 {
         Q_OBJECT
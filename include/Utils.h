@@ -0,0 +1,65 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QUrl>
+
+namespace utils {
+
+enum class ThumbnailMethod
+{
+        Crop,
+        Scale,
+};
+
+// Returns the thumbnail size, out of the ones the homeserver pre-generates,
+// that covers an area of `size` logical pixels on a screen with the given
+// device pixel ratio. The largest available size is used as a fallback.
+// Cropped thumbnails are always square.
+QSize
+thumbnailSize(const QSize &size, qreal devicePixelRatio, ThumbnailMethod method);
+
+// Convert an mxc:// URI into the URL of the original media.
+// An invalid URL is returned if the URI is malformed.
+QUrl
+mediaDownloadUrl(const QUrl &server, const QString &mxcUrl);
+
+// Convert an mxc:// URI into the URL of a server side thumbnail.
+// An invalid URL is returned if the URI is malformed.
+QUrl
+mediaThumbnailUrl(const QUrl &server,
+                  const QString &mxcUrl,
+                  const QSize &size,
+                  ThumbnailMethod method);
+
+// Convert a plain text message to HTML in a single pass. The text is escaped,
+// newlines become line breaks and URLs, e-mail addresses and Matrix IDs
+// (@user:server, #alias:server) become links.
+QString
+linkifyMessage(const QString &text);
+
+// Decode an image so that it fits in `maxSize` device pixels, keeping its
+// aspect ratio. Large images are scaled by the decoder itself, so the full
+// resolution image is never allocated. Safe to call from any thread.
+QImage
+decodeImage(const QByteArray &data, const QSize &maxSize);
+}
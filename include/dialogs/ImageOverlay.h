@@ -27,7 +27,12 @@ class ImageOverlay : public QWidget
 {
         Q_OBJECT
 public:
-        ImageOverlay(QPixmap image, QWidget *parent = nullptr);
+        // The image is scaled to the screen and cached under `mediaId`. The
+        // original isn't kept around.
+        ImageOverlay(QPixmap image, const QString &mediaId, QWidget *parent = nullptr);
+
+        // The image previously displayed for this media, if it's still cached.
+        static QPixmap cachedImage(const QString &mediaId);
 
 protected:
         void mousePressEvent(QMouseEvent *event) override;
@@ -37,9 +42,6 @@ signals:
         void closing();
 
 private:
-        void scaleImage(int width, int height);
-
-        QPixmap originalImage_;
         QPixmap image_;
 
         QRect content_;
@@ -0,0 +1,37 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QString>
+
+namespace emoji {
+
+// Whether the codepoint is used by any emoji of resources/emoji.json.
+bool
+isEmoji(uint codepoint);
+
+// Length in UTF-16 code units of the emoji sequence starting at `pos`
+// (keycaps, flags, modifiers and ZWJ sequences), or 0 if there isn't one.
+int
+sequenceLength(const QString &text, int pos);
+
+// Wrap every emoji sequence of an HTML formatted message in a span with the
+// emoji font. Markup is copied as is.
+QString
+formatHtml(const QString &html);
+} // namespace emoji
@@ -27,6 +27,7 @@
 
 #include "AvatarProvider.h"
 #include "RoomInfoListItem.h"
+#include "Session.h"
 #include "TimelineViewManager.h"
 
 class ImageItem;
@@ -34,6 +35,7 @@ class AudioItem;
 class VideoItem;
 class FileItem;
 class Avatar;
+class MessageLabel;
 
 class TimelineItem : public QWidget
 {
@@ -79,14 +81,31 @@ public:
                      bool with_sender,
                      QWidget *parent);
 
+        // The room list preview of a remote message, without creating the item.
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Audio> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Emote> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::File> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Image> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Notice> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Text> &e);
+        static DescInfo describe(const mtx::events::RoomEvent<mtx::events::msg::Video> &e);
+
+        // An empty description is returned for events that are not messages.
+        static DescInfo describe(const mtx::events::collections::TimelineEvents &event);
+
         void setUserAvatar(const QImage &pixmap);
         DescInfo descriptionMessage() const { return descriptionMsg_; }
         QString eventId() const { return event_id_; }
 
+        // Lay out the body again if its height was estimated while it was
+        // off screen.
+        void updateEstimatedHeight();
+
         ~TimelineItem();
 
 protected:
         void paintEvent(QPaintEvent *event) override;
+        void showEvent(QShowEvent *event) override;
 
 private:
         void init();
@@ -98,20 +117,19 @@ private:
                                     bool withSender);
 
         template<class Event, class Widget>
-        void setupWidgetLayout(Widget *widget,
-                               const Event &event,
-                               const QString &msgDescription,
-                               bool withSender);
+        void setupWidgetLayout(Widget *widget, const Event &event, bool withSender);
+
+        template<class Event>
+        static DescInfo describeMessage(const Event &event, const QString &body);
 
         void generateBody(const QString &body);
         void generateBody(const QString &userid, const QString &body);
         void generateTimestamp(const QDateTime &time);
-        QString descriptiveTime(const QDateTime &then);
+        static QString descriptiveTime(const QDateTime &then);
 
         void setupAvatarLayout(const QString &userName);
         void setupSimpleLayout();
 
-        QString replaceEmoji(const QString &body);
         QString event_id_;
 
         DescInfo descriptionMsg_;
@@ -124,11 +142,16 @@ private:
 
         Avatar *userAvatar_;
 
+        // The avatar is resolved when the item is first shown, so items that
+        // are only measured don't fetch it.
+        Identifier avatarUser_;
+        bool isAvatarResolved_ = false;
+
         QFont font_;
 
         QLabel *timestamp_;
         QLabel *userName_;
-        QLabel *body_;
+        MessageLabel *body_;
 };
 
 template<class Widget>
@@ -138,7 +161,7 @@ TimelineItem::setupLocalWidgetLayout(Widget *widget,
                                      const QString &msgDescription,
                                      bool withSender)
 {
-        auto displayName = TimelineViewManager::displayName(userid);
+        auto displayName = TimelineViewManager::displayName(Identifier(userid));
         auto timestamp   = QDateTime::currentDateTime();
 
         descriptionMsg_ = {
@@ -156,7 +179,7 @@ TimelineItem::setupLocalWidgetLayout(Widget *widget,
                 setupAvatarLayout(displayName);
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(userid, this);
+                avatarUser_ = Identifier(userid);
         } else {
                 setupSimpleLayout();
         }
@@ -166,24 +189,17 @@ TimelineItem::setupLocalWidgetLayout(Widget *widget,
 
 template<class Event, class Widget>
 void
-TimelineItem::setupWidgetLayout(Widget *widget,
-                                const Event &event,
-                                const QString &msgDescription,
-                                bool withSender)
+TimelineItem::setupWidgetLayout(Widget *widget, const Event &event, bool withSender)
 {
         init();
 
         event_id_         = QString::fromStdString(event.event_id);
-        const auto sender = QString::fromStdString(event.sender);
+        const auto sender = Identifier(event.sender);
 
         auto timestamp   = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
         auto displayName = TimelineViewManager::displayName(sender);
 
-        QSettings settings;
-        descriptionMsg_ = {sender == settings.value("auth/user_id") ? "You" : displayName,
-                           sender,
-                           msgDescription,
-                           descriptiveTime(QDateTime::fromMSecsSinceEpoch(event.origin_server_ts))};
+        descriptionMsg_ = describe(event);
 
         generateTimestamp(timestamp);
 
@@ -198,7 +214,7 @@ TimelineItem::setupWidgetLayout(Widget *widget,
 
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(sender, this);
+                avatarUser_ = sender;
         } else {
                 setupSimpleLayout();
         }
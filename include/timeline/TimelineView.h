@@ -17,12 +17,16 @@
 
 #pragma once
 
+#include <deque>
+
 #include <QApplication>
 #include <QDebug>
+#include <QHash>
 #include <QLayout>
 #include <QList>
 #include <QQueue>
 #include <QScrollArea>
+#include <QSet>
 #include <QSettings>
 #include <QStyle>
 #include <QStyleOption>
@@ -46,22 +50,34 @@ struct PendingMessage
         QString filename;
         QString event_id;
         TimelineItem *widget;
+        bool with_sender;
 
         PendingMessage(mtx::events::MessageType ty,
                        int txn_id,
                        QString body,
                        QString filename,
                        QString event_id,
-                       TimelineItem *widget)
+                       TimelineItem *widget,
+                       bool with_sender)
           : ty(ty)
           , txn_id(txn_id)
           , body(body)
           , filename(filename)
           , event_id(event_id)
           , widget(widget)
+          , with_sender(with_sender)
         {}
 };
 
+// What's needed to rebuild the TimelineItem of a message.
+struct TimelineRow
+{
+        mtx::events::collections::TimelineEvents event;
+        bool withSender;
+        // The height of the item when it was destroyed.
+        int height;
+};
+
 // In which place new TimelineItems should be inserted.
 enum class TimelineDirection
 {
@@ -91,16 +107,27 @@ public:
         void updatePendingMessage(int txn_id, QString event_id);
         void scrollDown();
 
+        // Distance in pixels of the scroll bar from the bottom of the timeline.
+        int scrollOffset() const;
+        // Keep the scroll bar at the given distance from the bottom, instead
+        // of scrolling down, the first time the view is shown.
+        void restoreScrollOffset(int offset) { restoredOffset_ = offset; }
+
+        bool hasPendingMessages() const
+        {
+                return !pending_msgs_.isEmpty() || !pending_sent_msgs_.isEmpty();
+        }
+
 public slots:
         void sliderRangeChanged(int min, int max);
         void sliderMoved(int position);
         void fetchHistory();
 
         // Add old events at the top of the timeline.
-        void addBackwardsEvents(const QString &room_id, const mtx::responses::Messages &msgs);
+        void addBackwardsEvents(const mtx::responses::Messages &msgs);
 
         // Whether or not the initial batch has been loaded.
-        bool hasLoaded() { return scroll_layout_->count() > 1 || isTimelineFinished; }
+        bool hasLoaded() const { return isLoaded_; }
 
         void handleFailedMessage(int txnid);
 
@@ -111,6 +138,10 @@ signals:
         void updateLastTimelineMessage(const QString &user, const DescInfo &info);
         void clearUnreadMessageCount(const QString &room_id);
 
+        // Emitted once, when the first batch of messages has been rendered
+        // or the room turned out to have none.
+        void loaded();
+
 protected:
         void paintEvent(QPaintEvent *event) override;
         void showEvent(QShowEvent *event) override;
@@ -119,8 +150,26 @@ protected:
 private:
         void init();
         void addTimelineItem(TimelineItem *item, TimelineDirection direction);
+        // Fetch the previous page of the history.
+        void requestMessages();
+
+        // Only the items around the viewport are kept as widgets. The rest
+        // are destroyed and replaced by spacers of the same height, so the
+        // layout cost doesn't depend on the length of the history.
+        void updateVisibleItems();
+        // Move an item at the edge of the layout to the hidden rows.
+        void hideItem(TimelineItem *item, TimelineDirection direction);
+        // Rebuild all the hidden rows on one side of the layout.
+        void showHiddenRows(TimelineDirection direction);
+        // Move the window of items to the end of the timeline, e.g for a
+        // local echo, without rebuilding the rows in between.
+        void jumpToBottom();
+        TimelineItem *restoreItem(const TimelineRow &row);
+        void updateSpacers();
+        bool hasItems() const;
         void updateLastSender(const QString &user_id, TimelineDirection direction);
         void notifyForLastEvent();
+        void updateLoadedState();
         void readLastEvent() const;
         QString getLastEventId() const;
         QString getEventSender(const mtx::events::collections::TimelineEvents &event) const;
@@ -146,9 +195,12 @@ private:
         bool isSenderRendered(const QString &user_id, TimelineDirection direction);
 
         bool isPendingMessage(const QString &txnid, const QString &sender, const QString &userid);
-        void removePendingMessage(const QString &txnid);
+        // The event that confirmed the message is kept to rebuild its item.
+        void removePendingMessage(const QString &txnid,
+                                  const mtx::events::collections::TimelineEvents &event);
 
-        bool isDuplicate(const QString &event_id) { return eventIds_.contains(event_id); }
+        bool isDuplicate(const QString &event_id) const { return eventIds_.contains(event_id); }
+        void addEventId(const QString &event_id);
 
         void handleNewUserMessage(PendingMessage msg);
 
@@ -159,6 +211,19 @@ private:
         QVBoxLayout *top_layout_;
         QVBoxLayout *scroll_layout_;
 
+        // The layout holds a stretch, the top spacer, the items and the
+        // bottom spacer in this order.
+        static constexpr int FirstItemIndex = 2;
+
+        // Items are rebuilt within KeepMargin viewport heights of the visible
+        // area and destroyed past DiscardMargin, so small scroll movements
+        // don't recreate widgets.
+        static constexpr int KeepMargin    = 2;
+        static constexpr int DiscardMargin = 4;
+
+        QWidget *topSpacer_;
+        QWidget *bottomSpacer_;
+
         QScrollArea *scroll_area_;
         ScrollBar *scrollbar_;
         QWidget *scroll_widget_;
@@ -175,10 +240,12 @@ private:
         bool isInitialized      = false;
         bool isTimelineFinished = false;
         bool isInitialSync      = true;
+        bool isLoaded_          = false;
 
         const int SCROLL_BAR_GAP = 200;
 
         QTimer *paginationTimer_;
+        QTimer *visibilityTimer_;
 
         int scroll_height_       = 0;
         int previous_max_height_ = 0;
@@ -186,12 +253,36 @@ private:
         int oldPosition_;
         int oldHeight_;
 
+        // Scroll offset from the bottom to be restored, if any.
+        int restoredOffset_ = 0;
+        // Move to the bottom once the layout has caught up with a jump.
+        bool isJumpingToBottom_ = false;
+
         FloatingButton *scrollDownBtn_;
 
         TimelineDirection lastMessageDirection_;
 
-        // The events currently rendered. Used for duplicate detection.
-        QMap<QString, bool> eventIds_;
+        // The latest events added to the timeline, oldest first. Used for
+        // duplicate detection.
+        QSet<QString> eventIds_;
+        std::deque<QString> eventIdOrder_;
+
+        // Number of event ids kept for duplicate detection. Duplicates come
+        // from overlapping sync and pagination responses, which are close to
+        // each other.
+        static constexpr std::size_t MaxEventIds = 2000;
+
+        // Transaction ids of the local echoes waiting for their remote event.
+        QSet<int> pendingTxnIds_;
+
+        // Items that can be destroyed and rebuilt from their event.
+        QHash<TimelineItem *, TimelineRow> rows_;
+        // Messages above and below the items of the layout, oldest first.
+        std::deque<TimelineRow> hiddenAbove_;
+        std::deque<TimelineRow> hiddenBelow_;
+        int hiddenAboveHeight_ = 0;
+        int hiddenBelowHeight_ = 0;
+
         QQueue<PendingMessage> pending_msgs_;
         QList<PendingMessage> pending_sent_msgs_;
         QSharedPointer<MatrixClient> client_;
@@ -201,24 +292,21 @@ template<class Widget, mtx::events::MessageType MsgType>
 void
 TimelineView::addUserMessage(const QString &url, const QString &filename)
 {
-        QSettings settings;
-        auto user_id     = settings.value("auth/user_id").toString();
-        auto with_sender = lastSender_ != user_id;
+        const auto &user_id = local_user_;
+        auto with_sender    = lastSender_ != user_id;
 
         auto widget = new Widget(client_, url, filename, this);
 
         TimelineItem *view_item = new TimelineItem(widget, user_id, with_sender, scroll_widget_);
-        scroll_layout_->addWidget(view_item);
+        addTimelineItem(view_item, TimelineDirection::Bottom);
 
         lastMessageDirection_ = TimelineDirection::Bottom;
 
-        QApplication::processEvents();
-
         lastSender_ = user_id;
 
         int txn_id = client_->incrementTransactionId();
 
-        PendingMessage message(MsgType, txn_id, url, filename, "", view_item);
+        PendingMessage message(MsgType, txn_id, url, filename, "", view_item, with_sender);
         handleNewUserMessage(message);
 }
 
@@ -227,6 +315,8 @@ TimelineItem *
 TimelineView::createTimelineItem(const Event &event, bool withSender)
 {
         TimelineItem *item = new TimelineItem(event, withSender, scroll_widget_);
+        rows_.insert(item, TimelineRow{event, withSender, 0});
+
         return item;
 }
 
@@ -236,6 +326,7 @@ TimelineView::createTimelineItem(const Event &event, bool withSender)
 {
         auto eventWidget = new Widget(client_, event);
         auto item        = new TimelineItem(eventWidget, event, withSender, scroll_widget_);
+        rows_.insert(item, TimelineRow{event, withSender, 0});
 
         return item;
 }
@@ -250,11 +341,11 @@ TimelineView::processMessageEvent(const Event &event, TimelineDirection directio
         if (isDuplicate(event_id))
                 return nullptr;
 
-        eventIds_[event_id] = true;
+        addEventId(event_id);
 
         const QString txnid = QString::fromStdString(event.unsigned_data.transaction_id);
         if (!txnid.isEmpty() && isPendingMessage(txnid, sender, local_user_)) {
-                removePendingMessage(txnid);
+                removePendingMessage(txnid, event);
                 return nullptr;
         }
 
@@ -275,11 +366,11 @@ TimelineView::processMessageEvent(const Event &event, TimelineDirection directio
         if (isDuplicate(event_id))
                 return nullptr;
 
-        eventIds_[event_id] = true;
+        addEventId(event_id);
 
         const QString txnid = QString::fromStdString(event.unsigned_data.transaction_id);
         if (!txnid.isEmpty() && isPendingMessage(txnid, sender, local_user_)) {
-                removePendingMessage(txnid);
+                removePendingMessage(txnid, event);
                 return nullptr;
         }
 
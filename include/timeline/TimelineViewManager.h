@@ -17,12 +17,15 @@
 
 #pragma once
 
+#include <QHash>
 #include <QMap>
 #include <QSharedPointer>
 #include <QStackedWidget>
 
 #include <mtx.hpp>
 
+#include "Identifier.h"
+
 class MatrixClient;
 class RoomInfoListItem;
 class TimelineView;
@@ -36,9 +39,7 @@ public:
         TimelineViewManager(QSharedPointer<MatrixClient> client, QWidget *parent);
         ~TimelineViewManager();
 
-        // Initialize with timeline events.
-        void initialize(const mtx::responses::Rooms &rooms);
-        // Empty initialization.
+        // Empty initialization. The views are created when a room is opened.
         void initialize(const QList<QString> &rooms);
 
         void addRoom(const mtx::responses::JoinedRoom &room, const QString &room_id);
@@ -47,18 +48,21 @@ public:
         void sync(const mtx::responses::Rooms &rooms);
         void clearAll();
 
-        // Check if all the timelines have been loaded.
-        bool hasLoaded() const;
+        // The latest message of every room, as far as the buffered events
+        // go. Used to order the room list when it's populated.
+        QMap<QString, DescInfo> lastMessages() const;
 
         static QString chooseRandomColor();
-        static QString displayName(const QString &userid);
+        static QString displayName(const Identifier &userid);
 
-        static QMap<QString, QString> DISPLAY_NAMES;
+        static QHash<Identifier, QString> DISPLAY_NAMES;
 
 signals:
         void clearRoomMessageCount(QString roomid);
         void unreadMessages(QString roomid, int count);
         void updateRoomsLastMessage(const QString &user, const DescInfo &info);
+        // The timeline of the active room has messages to show.
+        void activeTimelineLoaded();
 
 public slots:
         void setHistoryView(const QString &room_id);
@@ -73,7 +77,39 @@ private slots:
         void messageSendFailed(const QString &roomid, int txnid);
 
 private:
+        // Returns the view of a known room, creating it if the room hasn't
+        // been opened yet. A null pointer is returned for unknown rooms.
+        QSharedPointer<TimelineView> timelineView(const QString &room_id);
+        QSharedPointer<TimelineView> createView(const QString &room_id);
+
+        // Keep the latest events of a room, used to (re)create its view.
+        void bufferEvents(const QString &room_id, const mtx::responses::Timeline &timeline);
+
+        // Destroy the least recently viewed views until the budget is met.
+        void evictViews();
+
+        // Maximum number of events buffered for a room. Older events are
+        // dropped and fetched through pagination when the view is created.
+        static constexpr std::size_t MaxBufferedEvents = 100;
+
+        // Default number of views kept alive. Configurable through the
+        // "user/timeline/max_views" setting.
+        static constexpr int DefaultMaxViews = 10;
+
         QString active_room_;
         QMap<QString, QSharedPointer<TimelineView>> views_;
+
+        // The latest events received for every room. A view that gets
+        // evicted is rebuilt from them when the room is visited again.
+        QMap<QString, mtx::responses::Timeline> timelines_;
+
+        // Rooms with a view, most recently viewed first.
+        QList<QString> recentRooms_;
+
+        // Scroll positions of the evicted views.
+        QMap<QString, int> scrollOffsets_;
+
+        int maxViews_;
+
         QSharedPointer<MatrixClient> client_;
 };
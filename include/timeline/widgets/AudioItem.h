@@ -71,10 +71,8 @@ protected:
         void paintEvent(QPaintEvent *event) override;
         void mousePressEvent(QMouseEvent *event) override;
 
-private slots:
-        void fileDownloaded(const QString &event_id, const QByteArray &data);
-
 private:
+        void fileDownloaded(const QByteArray &data);
         QString calculateFileSize(int nbytes) const;
         void init();
 
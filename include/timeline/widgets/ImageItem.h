@@ -46,14 +46,12 @@ public:
 protected:
         void paintEvent(QPaintEvent *event) override;
         void mousePressEvent(QMouseEvent *event) override;
-        void resizeEvent(QResizeEvent *event) override;
-
-private slots:
-        void imageDownloaded(const QString &event_id, const QPixmap &img);
+        void showEvent(QShowEvent *event) override;
 
 private:
-        void scaleImage();
+        void imageDownloaded(const QImage &img);
         void openUrl();
+        void openOverlay();
 
         int max_width_  = 500;
         int max_height_ = 300;
@@ -61,14 +59,26 @@ private:
         int width_;
         int height_;
 
+        // Only the image scaled for display is kept. The original is
+        // released once it has been scaled.
         QPixmap scaled_image_;
-        QPixmap image_;
 
         QUrl url_;
         QString text_;
 
+        // The mxc:// URI of the image, used as the cache key.
+        QString mediaId_;
+
+        // The file a local echo was created from.
+        QString localFile_;
+
         int bottom_height_ = 30;
 
+        // Whether the original image has been requested for the overlay and
+        // the thumbnail for the timeline.
+        bool isOverlayRequested_   = false;
+        bool isThumbnailRequested_ = false;
+
         mtx::events::RoomEvent<mtx::events::msg::Image> event_;
 
         QSharedPointer<MatrixClient> client_;
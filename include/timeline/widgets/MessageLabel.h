@@ -0,0 +1,64 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QLabel>
+#include <QSharedPointer>
+
+class QTimer;
+
+// Word wrapped label for message bodies.
+//
+// Laying out rich text is the most expensive part of a timeline resize, so
+// the heights of the body for each width are cached and shared between the
+// labels with the same text. When the width changes, only the labels on screen
+// are laid out immediately. The rest keep the height of the nearest known
+// width, and compute their new height in a worker thread once the width
+// stops changing.
+class MessageLabel : public QLabel
+{
+public:
+        explicit MessageLabel(QWidget *parent = nullptr);
+
+        int heightForWidth(int width) const override;
+
+        // Whether the last height given to the layout was an estimate.
+        bool hasEstimatedHeight() const { return hasEstimatedHeight_; }
+
+private:
+        // Time in ms the width has to stay the same before the height of
+        // an off screen label is computed.
+        static constexpr int LayoutDelay = 200;
+
+        // Compute the height in a worker thread, after the width has
+        // settled, and update the geometry of the label when it's ready.
+        // A layout that is pending for another width is superseded.
+        void scheduleLayout(int width) const;
+        void startLayout() const;
+
+        QString cacheKey() const;
+
+        mutable bool hasEstimatedHeight_ = false;
+        mutable int pendingWidth_        = -1;
+        mutable QTimer *layoutTimer_     = nullptr;
+
+        // Incremented when a layout is scheduled. Queued jobs for an older
+        // generation are skipped.
+        QSharedPointer<QAtomicInt> generation_;
+};
@@ -37,6 +37,11 @@ protected:
 private:
         void init();
 
+        // Render the image or the letter into pixmap_. The pixmaps are
+        // shared by all the avatars with the same content, size and device
+        // pixel ratio, so identical avatars are only rendered once.
+        void updatePixmap();
+
         ui::AvatarType type_;
         QChar letter_;
         QColor background_color_;
@@ -3,7 +3,10 @@
 import sys
 import json
 
-from jinja2 import Template
+try:
+    from jinja2 import Template
+except ImportError:
+    Template = None
 
 
 class Emoji(object):
@@ -23,6 +26,51 @@ def code_to_bytes(codepoint):
     return str(bytes)[1:].strip("'")
 
 
+def is_sequence_component(codepoint):
+    '''
+    Codepoints that only modify or join emoji: ZWJ, variation selectors,
+    the keycap, skin tones and tags. Keycap bases (ASCII) are excluded too.
+    '''
+    return (codepoint < 0x80 or
+            codepoint in (0x200d, 0xfe0e, 0xfe0f, 0x20e3) or
+            0x1f3fb <= codepoint <= 0x1f3ff or
+            0xe0020 <= codepoint <= 0xe007f)
+
+
+def generate_ranges(data):
+    '''
+    Print the sorted ranges of the codepoints used by emoji, as used by the
+    emoji segmenter (src/emoji/Segmenter.cc).
+    '''
+    codepoints = set()
+
+    for emoji_name in data:
+        tmp = data[emoji_name]
+
+        for sequence in (tmp['unicode'], tmp['unicode_alt']):
+            if not sequence:
+                continue
+
+            for code in sequence.split('-'):
+                codepoint = int(code, 16)
+
+                if not is_sequence_component(codepoint):
+                    codepoints.add(codepoint)
+
+    ranges = []
+
+    for codepoint in sorted(codepoints):
+        if ranges and ranges[-1][1] + 1 == codepoint:
+            ranges[-1][1] = codepoint
+        else:
+            ranges.append([codepoint, codepoint])
+
+    print('const EmojiRange EMOJI_RANGES[] = {')
+    for first, last in ranges:
+        print('  {{0x{:x}, 0x{:x}}},'.format(first, last))
+    print('};')
+
+
 def generate_code(emojis, category):
     tmpl = Template('''
 const QList<Emoji> EmojiProvider::{{ category }} = {
@@ -38,15 +86,19 @@ const QList<Emoji> EmojiProvider::{{ category }} = {
 
 if __name__ == '__main__':
     if len(sys.argv) < 2:
-        print('usage: emoji_codegen.py /path/to/emoji.json')
+        print('usage: emoji_codegen.py [--ranges] /path/to/emoji.json')
         sys.exit(1)
 
-    filename = sys.argv[1]
+    filename = sys.argv[-1]
     data = {}
 
     with open(filename, 'r') as filename:
         data = json.loads(filename.read())
 
+    if '--ranges' in sys.argv[1:-1]:
+        generate_ranges(data)
+        sys.exit(0)
+
     emojis = []
 
     for emoji_name in data:
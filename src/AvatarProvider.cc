@@ -22,8 +22,8 @@
 
 QSharedPointer<MatrixClient> AvatarProvider::client_;
 
-QMap<QString, AvatarData> AvatarProvider::avatars_;
-QMap<QString, QList<TimelineItem *>> AvatarProvider::toBeResolved_;
+QHash<Identifier, AvatarData> AvatarProvider::avatars_;
+QHash<Identifier, QList<QPointer<TimelineItem>>> AvatarProvider::toBeResolved_;
 
 void
 AvatarProvider::init(QSharedPointer<MatrixClient> client)
@@ -34,14 +34,19 @@ AvatarProvider::init(QSharedPointer<MatrixClient> client)
 }
 
 void
-AvatarProvider::updateAvatar(const QString &uid, const QImage &img)
+AvatarProvider::updateAvatar(const QString &user_id, const QImage &img)
 {
+        const auto uid = Identifier(user_id);
+
         if (toBeResolved_.contains(uid)) {
                 auto items = toBeResolved_[uid];
 
-                // Update all the timeline items with the resolved avatar.
-                for (const auto item : items)
-                        item->setUserAvatar(img);
+                // Update all the timeline items with the resolved avatar. The
+                // avatar widgets share a single pre-rendered pixmap.
+                for (const auto &item : items) {
+                        if (!item.isNull())
+                                item->setUserAvatar(img);
+                }
 
                 toBeResolved_.remove(uid);
         }
@@ -53,7 +58,7 @@ AvatarProvider::updateAvatar(const QString &uid, const QImage &img)
 }
 
 void
-AvatarProvider::resolve(const QString &userId, TimelineItem *item)
+AvatarProvider::resolve(const Identifier &userId, TimelineItem *item)
 {
         if (!avatars_.contains(userId))
                 return;
@@ -67,9 +72,9 @@ AvatarProvider::resolve(const QString &userId, TimelineItem *item)
 
         // Add the current timeline item to the waiting list for this avatar.
         if (!toBeResolved_.contains(userId)) {
-                client_->fetchUserAvatar(userId, avatars_[userId].url);
+                client_->fetchUserAvatar(userId.toString(), avatars_[userId].url);
 
-                QList<TimelineItem *> timelineItems;
+                QList<QPointer<TimelineItem>> timelineItems;
                 timelineItems.push_back(item);
 
                 toBeResolved_.insert(userId, timelineItems);
@@ -79,7 +84,7 @@ AvatarProvider::resolve(const QString &userId, TimelineItem *item)
 }
 
 void
-AvatarProvider::setAvatarUrl(const QString &userId, const QUrl &url)
+AvatarProvider::setAvatarUrl(const Identifier &userId, const QUrl &url)
 {
         AvatarData data;
         data.url = url;
@@ -192,7 +192,7 @@ Cache::states()
                 state.parse(json);
 
                 auto memberDb = lmdb::dbi::open(txn, roomid.toStdString().c_str(), MDB_CREATE);
-                std::map<std::string, mtx::events::StateEvent<mtx::events::state::Member>> members;
+                RoomMembers::Map members;
 
                 auto memberCursor = lmdb::cursor::open(txn, memberDb);
 
@@ -200,12 +200,10 @@ Cache::states()
                 std::string memberContent;
 
                 while (memberCursor.get(memberId, memberContent, MDB_NEXT)) {
-                        auto userid = QString::fromStdString(memberId);
-
                         try {
                                 auto data = nlohmann::json::parse(memberContent);
                                 mtx::events::StateEvent<mtx::events::state::Member> member = data;
-                                members.emplace(memberId, member);
+                                members.emplace(Identifier(memberId), std::move(member));
                         } catch (std::exception &e) {
                                 qWarning() << "Fault while parsing member event" << e.what()
                                            << QString::fromStdString(memberContent);
@@ -215,8 +213,8 @@ Cache::states()
 
                 qDebug() << members.size() << "members for" << roomid;
 
-                state.memberships = members;
-                states.insert(roomid, state);
+                state.memberships = std::move(members);
+                states[roomid]    = std::move(state);
         }
 
         qDebug() << "Retrieved" << states.size() << "rooms";
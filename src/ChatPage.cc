@@ -15,6 +15,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include <QApplication>
 #include <QDebug>
 #include <QSettings>
@@ -23,15 +25,20 @@
 #include "AvatarProvider.h"
 #include "Cache.h"
 #include "ChatPage.h"
+#include "ImageCache.h"
 #include "MainWindow.h"
 #include "MatrixClient.h"
 #include "OverlayModal.h"
 #include "QuickSwitcher.h"
+#include "RoomInfoListItem.h"
 #include "RoomList.h"
 #include "RoomSettings.h"
 #include "RoomState.h"
+#include "Session.h"
 #include "SideBarActions.h"
 #include "Splitter.h"
+#include "StartupProfiler.h"
+#include "TaskScheduler.h"
 #include "TextInputWidget.h"
 #include "Theme.h"
 #include "TopRoomBar.h"
@@ -43,6 +50,24 @@
 constexpr int MAX_INITIAL_SYNC_FAILURES = 5;
 constexpr int SYNC_RETRY_TIMEOUT        = 10000;
 
+// Number of state events or members of a room processed in one chunk of the
+// initial sync.
+constexpr std::size_t INITIAL_SYNC_BATCH_SIZE = 500;
+
+namespace {
+// How far the initialization of the current room of the initial sync has got.
+struct InitialSyncProgress
+{
+        std::map<std::string, mtx::responses::JoinedRoom>::const_iterator room;
+        std::size_t stateEvents;
+        bool isStateResolved;
+        // A shared copy of the member list, so it can be iterated across
+        // chunks even if the state of the room is modified meanwhile.
+        RoomMembers members;
+        RoomMembers::const_iterator member;
+};
+}
+
 ChatPage::ChatPage(QSharedPointer<MatrixClient> client, QWidget *parent)
   : QWidget(parent)
   , client_(client)
@@ -260,19 +285,15 @@ ChatPage::ChatPage(QSharedPointer<MatrixClient> client, QWidget *parent)
 
         showContentTimer_ = new QTimer(this);
         showContentTimer_->setSingleShot(true);
-        connect(showContentTimer_, &QTimer::timeout, this, [=]() {
-                consensusTimer_->stop();
-                emit contentLoaded();
-        });
+        connect(showContentTimer_, &QTimer::timeout, this, &ChatPage::contentLoaded);
 
-        consensusTimer_ = new QTimer(this);
-        connect(consensusTimer_, &QTimer::timeout, this, [=]() {
-                if (view_manager_->hasLoaded()) {
-                        // Remove the spinner overlay.
-                        emit contentLoaded();
-                        showContentTimer_->stop();
-                        consensusTimer_->stop();
-                }
+        connect(view_manager_, &TimelineViewManager::activeTimelineLoaded, this, [=]() {
+                if (!showContentTimer_->isActive())
+                        return;
+
+                // Remove the spinner overlay.
+                showContentTimer_->stop();
+                emit contentLoaded();
         });
 
         AvatarProvider::init(client);
@@ -291,6 +312,8 @@ ChatPage::logout()
 void
 ChatPage::resetUI()
 {
+        TaskScheduler::instance()->cancel(this);
+
         room_avatars_.clear();
         room_list_->clear();
         settingsManager_.clear();
@@ -299,6 +322,7 @@ ChatPage::resetUI()
         user_info_widget_->reset();
         view_manager_->clearAll();
         AvatarProvider::clear();
+        ImageCache::clear();
 
         showUnreadMessageNotification(0);
 }
@@ -317,6 +341,8 @@ ChatPage::deleteConfigs()
         settings.remove("");
         settings.endGroup();
 
+        Session::instance()->clear();
+
         cache_->deleteData();
 
         client_->reset();
@@ -325,6 +351,8 @@ ChatPage::deleteConfigs()
 void
 ChatPage::bootstrap(QString userid, QString homeserver, QString token)
 {
+        StartupProfiler::Phase phase("ChatPage::bootstrap");
+
         client_->setServer(homeserver);
         client_->setAccessToken(token);
         client_->getOwnProfile();
@@ -332,7 +360,9 @@ ChatPage::bootstrap(QString userid, QString homeserver, QString token)
         cache_ = QSharedPointer<Cache>(new Cache(userid));
 
         try {
+                StartupProfiler::beginPhase("Cache::setup");
                 cache_->setup();
+                StartupProfiler::endPhase("Cache::setup");
 
                 if (cache_->isInitialized()) {
                         loadStateFromCache();
@@ -349,9 +379,9 @@ ChatPage::bootstrap(QString userid, QString homeserver, QString token)
 }
 
 void
-ChatPage::setOwnAvatar(const QPixmap &img)
+ChatPage::setOwnAvatar(const QImage &img)
 {
-        user_info_widget_->setAvatar(img.toImage());
+        user_info_widget_->setAvatar(img);
 }
 
 void
@@ -368,7 +398,7 @@ ChatPage::syncFailed(const QString &msg)
 void
 ChatPage::syncCompleted(const mtx::responses::Sync &response)
 {
-        updateJoinedRooms(response.rooms.join);
+        const auto changedRooms = updateJoinedRooms(response.rooms.join);
         removeLeftRooms(response.rooms.leave);
 
         const auto nextBatchToken = QString::fromStdString(response.next_batch);
@@ -376,7 +406,7 @@ ChatPage::syncCompleted(const mtx::responses::Sync &response)
         auto stateDiff = generateMembershipDifference(response.rooms.join, state_manager_);
         QtConcurrent::run(cache_.data(), &Cache::setState, nextBatchToken, stateDiff);
 
-        room_list_->sync(state_manager_, settingsManager_);
+        room_list_->sync(state_manager_, changedRooms, settingsManager_);
         view_manager_->sync(response.rooms);
 
         client_->setNextBatchToken(nextBatchToken);
@@ -384,73 +414,120 @@ ChatPage::syncCompleted(const mtx::responses::Sync &response)
 }
 
 void
-ChatPage::initialSyncCompleted(const mtx::responses::Sync &response)
+ChatPage::initialSyncCompleted(QSharedPointer<mtx::responses::Sync> response)
 {
-        auto joined = response.rooms.join;
+        InitialSyncProgress progress;
+        progress.room            = response->rooms.join.cbegin();
+        progress.stateEvents     = 0;
+        progress.isStateResolved = false;
+
+        // Rooms are processed from the event loop in chunks of at most
+        // INITIAL_SYNC_BATCH_SIZE state events or members, so the UI stays
+        // responsive with a large number of rooms or a room with a lot of
+        // members.
+        TaskScheduler::instance()->schedule(this, [this, response, progress]() mutable {
+                if (progress.room != response->rooms.join.cend()) {
+                        const auto room_id = QString::fromStdString(progress.room->first);
+                        const auto &room   = progress.room->second;
+                        auto &room_state   = state_manager_[room_id];
+
+                        const auto &events = room.state.events;
+
+                        if (progress.stateEvents < events.size()) {
+                                const auto count = std::min(INITIAL_SYNC_BATCH_SIZE,
+                                                            events.size() - progress.stateEvents);
+                                const auto first = events.cbegin() + progress.stateEvents;
+
+                                room_state.updateFromEvents(first, first + count);
+                                progress.stateEvents += count;
+
+                                return true;
+                        }
 
-        for (auto it = joined.cbegin(); it != joined.cend(); ++it) {
-                RoomState room_state;
+                        if (!progress.isStateResolved) {
+                                resolveJoinedRoomState(room_id, room);
 
-                // Build the current state from the timeline and state events.
-                room_state.updateFromEvents(it->second.state.events);
-                room_state.updateFromEvents(it->second.timeline.events);
+                                progress.isStateResolved = true;
+                                progress.members         = room_state.memberships;
+                                progress.member          = progress.members.cbegin();
 
-                // Remove redundant memberships.
-                room_state.removeLeaveMemberships();
+                                return true;
+                        }
 
-                // Resolve room name and avatar. e.g in case of one-to-one chats.
-                room_state.resolveName();
-                room_state.resolveAvatar();
+                        for (std::size_t i = 0; i < INITIAL_SYNC_BATCH_SIZE; ++i) {
+                                if (progress.member == progress.members.cend())
+                                        break;
 
-                const auto room_id = QString::fromStdString(it->first);
+                                updateUserDisplayName(progress.member->second);
+                                updateUserAvatarUrl(progress.member->second);
+                                ++progress.member;
+                        }
 
-                state_manager_.insert(room_id, room_state);
-                settingsManager_.insert(room_id,
-                                        QSharedPointer<RoomSettings>(new RoomSettings(room_id)));
+                        if (progress.member != progress.members.cend())
+                                return true;
 
-                for (const auto membership : room_state.memberships) {
-                        updateUserDisplayName(membership.second);
-                        updateUserAvatarUrl(membership.second);
+                        // Populate the timeline with messages.
+                        view_manager_->addRoom(room, room_id);
+
+                        ++progress.room;
+                        progress.stateEvents     = 0;
+                        progress.isStateResolved = false;
+                        progress.members         = RoomMembers();
+
+                        return true;
                 }
 
-                QApplication::processEvents();
-        }
+                const auto nextBatchToken = QString::fromStdString(response->next_batch);
 
-        QtConcurrent::run(cache_.data(),
-                          &Cache::setState,
-                          QString::fromStdString(response.next_batch),
-                          state_manager_);
+                QtConcurrent::run(cache_.data(), &Cache::setState, nextBatchToken, state_manager_);
 
-        // Populate timelines with messages.
-        view_manager_->initialize(response.rooms);
+                // Initialize room list.
+                room_list_->setInitialRooms(
+                  settingsManager_, state_manager_, view_manager_->lastMessages());
 
-        // Initialize room list.
-        room_list_->setInitialRooms(settingsManager_, state_manager_);
+                client_->setNextBatchToken(nextBatchToken);
+                client_->sync();
 
-        client_->setNextBatchToken(QString::fromStdString(response.next_batch));
-        client_->sync();
+                emit contentLoaded();
 
-        emit contentLoaded();
+                return false;
+        });
 }
 
 void
-ChatPage::updateTopBarAvatar(const QString &roomid, const QPixmap &img)
+ChatPage::resolveJoinedRoomState(const QString &room_id, const mtx::responses::JoinedRoom &room)
+{
+        // Build the state in place to avoid copying the member list.
+        auto &room_state = state_manager_[room_id];
+
+        // The state events have already been applied.
+        room_state.updateFromEvents(room.timeline.events);
+
+        // Remove redundant memberships.
+        room_state.removeLeaveMemberships();
+
+        // Resolve room name and avatar. e.g in case of one-to-one chats.
+        room_state.resolveName();
+        room_state.resolveAvatar();
+
+        settingsManager_.insert(room_id, QSharedPointer<RoomSettings>(new RoomSettings(room_id)));
+}
+
+void
+ChatPage::updateTopBarAvatar(const QString &roomid, const QImage &img)
 {
         room_avatars_.insert(roomid, img);
 
         if (current_room_ != roomid)
                 return;
 
-        top_bar_->updateRoomAvatar(img.toImage());
+        top_bar_->updateRoomAvatar(img);
 }
 
 void
 ChatPage::updateOwnProfileInfo(const QUrl &avatar_url, const QString &display_name)
 {
-        QSettings settings;
-        auto userid = settings.value("auth/user_id").toString();
-
-        user_info_widget_->setUserId(userid);
+        user_info_widget_->setUserId(Session::instance()->userId());
         user_info_widget_->setDisplayName(display_name);
 
         if (avatar_url.isValid())
@@ -463,14 +540,14 @@ ChatPage::changeTopRoomInfo(const QString &room_id)
         if (!state_manager_.contains(room_id))
                 return;
 
-        auto state = state_manager_[room_id];
+        const auto &state = state_manager_[room_id];
 
         top_bar_->updateRoomName(state.getName());
         top_bar_->updateRoomTopic(state.getTopic());
         top_bar_->setRoomSettings(settingsManager_[room_id]);
 
         if (room_avatars_.contains(room_id))
-                top_bar_->updateRoomAvatar(room_avatars_.value(room_id).toImage());
+                top_bar_->updateRoomAvatar(room_avatars_.value(room_id));
         else
                 top_bar_->updateRoomAvatarFromName(state.getName());
 
@@ -492,48 +569,58 @@ ChatPage::showUnreadMessageNotification(int count)
 void
 ChatPage::loadStateFromCache()
 {
+        StartupProfiler::Phase phase("ChatPage::loadStateFromCache");
+
         qDebug() << "Restoring state from cache";
 
         qDebug() << "Restored nextBatchToken" << cache_->nextBatchToken();
         client_->setNextBatchToken(cache_->nextBatchToken());
 
         // Fetch all the joined room's state.
-        auto rooms = cache_->states();
+        StartupProfiler::beginPhase("Cache::states");
+        state_manager_ = cache_->states();
+        StartupProfiler::endPhase("Cache::states");
 
-        for (auto it = rooms.constBegin(); it != rooms.constEnd(); ++it) {
-                RoomState room_state = it.value();
+        for (auto it = state_manager_.begin(); it != state_manager_.end(); ++it) {
+                auto &room_state = it.value();
 
                 // Clean up and prepare state for use.
                 room_state.removeLeaveMemberships();
                 room_state.resolveName();
                 room_state.resolveAvatar();
 
-                // Save the current room state.
-                state_manager_.insert(it.key(), room_state);
-
                 // Create or restore the settings for this room.
                 settingsManager_.insert(it.key(),
                                         QSharedPointer<RoomSettings>(new RoomSettings(it.key())));
 
                 // Resolve user avatars.
-                for (const auto membership : room_state.memberships) {
+                for (const auto &membership : room_state.memberships) {
                         updateUserDisplayName(membership.second);
                         updateUserAvatarUrl(membership.second);
                 }
         }
 
         // Initializing empty timelines.
-        view_manager_->initialize(rooms.keys());
-
-        // Initialize room list from the restored state and settings.
-        room_list_->setInitialRooms(settingsManager_, state_manager_);
-
-        // Check periodically if the timelines have been loaded.
-        consensusTimer_->start(CONSENSUS_TIMEOUT);
+        StartupProfiler::beginPhase("TimelineViewManager::initialize");
+        view_manager_->initialize(state_manager_.keys());
+        StartupProfiler::endPhase("TimelineViewManager::initialize");
 
-        // Show the content if consensus can't be achieved.
+        // Wait for the timeline of the room selected by the room list, but
+        // show the content anyway if it takes too long.
         showContentTimer_->start(SHOW_CONTENT_TIMEOUT);
 
+        // Initialize room list from the restored state and settings.
+        StartupProfiler::beginPhase("RoomList::setInitialRooms");
+        room_list_->setInitialRooms(
+          settingsManager_, state_manager_, view_manager_->lastMessages());
+        StartupProfiler::endPhase("RoomList::setInitialRooms");
+
+        // There is no timeline to wait for.
+        if (state_manager_.isEmpty() && showContentTimer_->isActive()) {
+                showContentTimer_->stop();
+                emit contentLoaded();
+        }
+
         // Start receiving events.
         client_->sync();
 }
@@ -543,7 +630,7 @@ ChatPage::showQuickSwitcher()
 {
         if (quickSwitcher_.isNull()) {
                 quickSwitcher_ = QSharedPointer<QuickSwitcher>(
-                  new QuickSwitcher(this),
+                  new QuickSwitcher(&room_list_->searchIndex(), this),
                   [=](QuickSwitcher *switcher) { switcher->deleteLater(); });
 
                 connect(quickSwitcher_.data(),
@@ -566,17 +653,6 @@ ChatPage::showQuickSwitcher()
                 quickSwitcherModal_->setColor(QColor(30, 30, 30, 170));
         }
 
-        QMap<QString, QString> rooms;
-
-        for (auto it = state_manager_.constBegin(); it != state_manager_.constEnd(); ++it) {
-                QString deambiguator =
-                  QString::fromStdString(it.value().canonical_alias.content.alias);
-                if (deambiguator == "")
-                        deambiguator = it.key();
-                rooms.insert(it.value().getName() + " (" + deambiguator + ")", it.key());
-        }
-
-        quickSwitcher_->setRoomList(rooms);
         quickSwitcherModal_->fadeIn();
 }
 
@@ -618,11 +694,10 @@ ChatPage::updateTypingUsers(const QString &roomid, const std::vector<std::string
 {
         QStringList users;
 
-        QSettings settings;
-        QString user_id = settings.value("auth/user_id").toString();
+        const auto &user_id = Session::instance()->userIdentifier();
 
-        for (const auto uid : user_ids) {
-                auto user = QString::fromStdString(uid);
+        for (const auto &uid : user_ids) {
+                const auto user = Identifier(uid);
 
                 if (user == user_id)
                         continue;
@@ -642,11 +717,10 @@ ChatPage::updateTypingUsers(const QString &roomid, const std::vector<std::string
 void
 ChatPage::updateUserAvatarUrl(const mtx::events::StateEvent<mtx::events::state::Member> &membership)
 {
-        auto uid = QString::fromStdString(membership.sender);
         auto url = QString::fromStdString(membership.content.avatar_url);
 
         if (!url.isEmpty())
-                AvatarProvider::setAvatarUrl(uid, url);
+                AvatarProvider::setAvatarUrl(Identifier(membership.sender), url);
 }
 
 void
@@ -654,10 +728,10 @@ ChatPage::updateUserDisplayName(
   const mtx::events::StateEvent<mtx::events::state::Member> &membership)
 {
         auto displayName = QString::fromStdString(membership.content.display_name);
-        auto stateKey    = QString::fromStdString(membership.state_key);
 
         if (!displayName.isEmpty())
-                TimelineViewManager::DISPLAY_NAMES.insert(stateKey, displayName);
+                TimelineViewManager::DISPLAY_NAMES.insert(Identifier(membership.state_key),
+                                                          displayName);
 }
 
 void
@@ -671,36 +745,39 @@ ChatPage::removeLeftRooms(const std::map<std::string, mtx::responses::LeftRoom>
         }
 }
 
-void
+QList<QString>
 ChatPage::updateJoinedRooms(const std::map<std::string, mtx::responses::JoinedRoom> &rooms)
 {
+        QList<QString> changedRooms;
+
         for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
                 const auto roomid = QString::fromStdString(it->first);
 
                 updateTypingUsers(roomid, it->second.ephemeral.typing);
 
-                const auto newStateEvents    = it->second.state;
-                const auto newTimelineEvents = it->second.timeline;
+                const auto &newStateEvents    = it->second.state;
+                const auto &newTimelineEvents = it->second.timeline;
+
+                const bool isNewRoom = !state_manager_.contains(roomid);
 
-                // Merge the new updates for rooms that we are tracking.
-                if (state_manager_.contains(roomid)) {
-                        auto oldState = &state_manager_[roomid];
-                        oldState->updateFromEvents(newStateEvents.events);
-                        oldState->updateFromEvents(newTimelineEvents.events);
-                        oldState->resolveName();
-                        oldState->resolveAvatar();
-                } else {
-                        // Build the current state from the timeline and state events.
-                        RoomState room_state;
-                        room_state.updateFromEvents(newStateEvents.events);
-                        room_state.updateFromEvents(newTimelineEvents.events);
+                // Merge the new updates for rooms that we are tracking, or build
+                // the current state in place from the timeline and state events.
+                auto &room_state = state_manager_[roomid];
 
-                        // Resolve room name and avatar. e.g in case of one-to-one chats.
-                        room_state.resolveName();
-                        room_state.resolveAvatar();
+                const auto previousVersion = room_state.version();
 
-                        state_manager_.insert(roomid, room_state);
+                room_state.updateFromEvents(newStateEvents.events);
+                room_state.updateFromEvents(newTimelineEvents.events);
 
+                // Resolve room name and avatar. e.g in case of one-to-one chats.
+                room_state.resolveName();
+                room_state.resolveAvatar();
+
+                // Also covers changes that are only searchable, e.g new aliases.
+                if (isNewRoom || previousVersion != room_state.version())
+                        changedRooms.push_back(roomid);
+
+                if (isNewRoom) {
                         settingsManager_.insert(
                           roomid, QSharedPointer<RoomSettings>(new RoomSettings(roomid)));
 
@@ -712,9 +789,9 @@ ChatPage::updateJoinedRooms(const std::map<std::string, mtx::responses::JoinedRo
 
                 if (roomid == current_room_)
                         changeTopRoomInfo(roomid);
-
-                QApplication::processEvents();
         }
+
+        return changedRooms;
 }
 
 QMap<QString, RoomState>
@@ -727,28 +804,30 @@ ChatPage::generateMembershipDifference(
         for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
                 const auto room_id = QString::fromStdString(it->first);
 
-                if (!states.contains(room_id))
+                // QMap::operator[] returns a copy on a const map, which would
+                // duplicate the whole member list of the room.
+                const auto state = states.constFind(room_id);
+
+                if (state == states.constEnd())
                         continue;
 
                 auto all_memberships     = getMemberships(it->second.state.events);
                 auto timelineMemberships = getMemberships(it->second.timeline.events);
 
                 // We have to process first the state events and then the timeline.
-                for (auto mm = timelineMemberships.cbegin(); mm != timelineMemberships.cend(); ++mm)
-                        all_memberships.emplace(mm->first, mm->second);
-
-                RoomState local;
-                local.aliases            = states[room_id].aliases;
-                local.avatar             = states[room_id].avatar;
-                local.canonical_alias    = states[room_id].canonical_alias;
-                local.history_visibility = states[room_id].history_visibility;
-                local.join_rules         = states[room_id].join_rules;
-                local.name               = states[room_id].name;
-                local.power_levels       = states[room_id].power_levels;
-                local.topic              = states[room_id].topic;
-                local.memberships        = all_memberships;
-
-                stateDiff.insert(room_id, local);
+                for (auto &mm : timelineMemberships)
+                        all_memberships.emplace(mm.first, std::move(mm.second));
+
+                auto &local              = stateDiff[room_id];
+                local.aliases            = state->aliases;
+                local.avatar             = state->avatar;
+                local.canonical_alias    = state->canonical_alias;
+                local.history_visibility = state->history_visibility;
+                local.join_rules         = state->join_rules;
+                local.name               = state->name;
+                local.power_levels       = state->power_levels;
+                local.topic              = state->topic;
+                local.memberships        = std::move(all_memberships);
         }
 
         return stateDiff;
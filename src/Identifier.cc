@@ -0,0 +1,167 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unordered_map>
+
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include "Identifier.h"
+
+namespace {
+const std::string EMPTY_STD_STRING;
+const QString EMPTY_STRING;
+
+using StdStringRef = std::reference_wrapper<const std::string>;
+
+struct StdStringRefHash
+{
+        std::size_t operator()(const StdStringRef &ref) const
+        {
+                return std::hash<std::string>()(ref.get());
+        }
+};
+
+struct StdStringRefEqual
+{
+        bool operator()(const StdStringRef &a, const StdStringRef &b) const
+        {
+                return a.get() == b.get();
+        }
+};
+}
+
+struct Identifier::Entry
+{
+        std::string stdString;
+        QString string;
+};
+
+// The interned identifiers, indexed by both of their representations. The
+// indexes refer to the strings of the entries, so each identifier is stored
+// once in each form. The entries are never freed.
+struct Identifier::Table
+{
+        // Handles may be created from worker threads. Lookups of known
+        // identifiers only take the lock for reading.
+        QReadWriteLock lock;
+
+        std::unordered_map<StdStringRef, const Entry *, StdStringRefHash, StdStringRefEqual>
+          byStdString;
+        QHash<QString, const Entry *> byString;
+
+        // Add a new identifier. The lock has to be held for writing.
+        const Entry *insert(std::string stdString, QString string)
+        {
+                auto entry = new Entry{std::move(stdString), std::move(string)};
+
+                byStdString.emplace(std::cref(entry->stdString), entry);
+                byString.insert(entry->string, entry);
+
+                return entry;
+        }
+};
+
+Identifier::Identifier(const std::string &id)
+  : entry_(intern(id))
+{}
+
+Identifier::Identifier(const QString &id)
+  : entry_(intern(id))
+{}
+
+Identifier::Table &
+Identifier::table()
+{
+        static Table table;
+        return table;
+}
+
+const Identifier::Entry *
+Identifier::intern(const std::string &id)
+{
+        if (id.empty())
+                return nullptr;
+
+        auto &shared = table();
+
+        {
+                QReadLocker locker(&shared.lock);
+
+                auto it = shared.byStdString.find(std::cref(id));
+
+                if (it != shared.byStdString.end())
+                        return it->second;
+        }
+
+        QWriteLocker locker(&shared.lock);
+
+        // Another thread might have added it in the meantime.
+        auto it = shared.byStdString.find(std::cref(id));
+
+        if (it != shared.byStdString.end())
+                return it->second;
+
+        return shared.insert(id, QString::fromStdString(id));
+}
+
+const Identifier::Entry *
+Identifier::intern(const QString &id)
+{
+        if (id.isEmpty())
+                return nullptr;
+
+        auto &shared = table();
+
+        {
+                QReadLocker locker(&shared.lock);
+
+                if (auto entry = shared.byString.value(id, nullptr))
+                        return entry;
+        }
+
+        QWriteLocker locker(&shared.lock);
+
+        if (auto entry = shared.byString.value(id, nullptr))
+                return entry;
+
+        // A copy of its own, so the entry doesn't keep a larger buffer of the
+        // caller alive.
+        return shared.insert(id.toStdString(), QString(id.constData(), id.size()));
+}
+
+const std::string &
+Identifier::toStdString() const
+{
+        return entry_ ? entry_->stdString : EMPTY_STD_STRING;
+}
+
+const QString &
+Identifier::toString() const
+{
+        return entry_ ? entry_->string : EMPTY_STRING;
+}
+
+bool
+Identifier::operator<(const Identifier &other) const
+{
+        if (entry_ == other.entry_)
+                return false;
+
+        return toStdString() < other.toStdString();
+}
@@ -0,0 +1,90 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageCache.h"
+
+QCache<QString, QPixmap> ImageCache::pixmaps_(ImageCache::MaxCost);
+
+QString
+ImageCache::key(const QString &mediaId, const QSize &box, qreal pixelRatio)
+{
+        return QString("%1|%2x%3@%4")
+          .arg(mediaId)
+          .arg(box.width())
+          .arg(box.height())
+          .arg(pixelRatio);
+}
+
+QPixmap
+ImageCache::find(const QString &mediaId, const QSize &box, qreal pixelRatio)
+{
+        if (mediaId.isEmpty())
+                return QPixmap();
+
+        auto pixmap = pixmaps_.object(key(mediaId, box, pixelRatio));
+
+        return pixmap ? *pixmap : QPixmap();
+}
+
+QPixmap
+ImageCache::fitted(const QString &mediaId,
+                   const QPixmap &image,
+                   const QSize &box,
+                   qreal pixelRatio)
+{
+        if (image.isNull())
+                return QPixmap();
+
+        const auto cached = find(mediaId, box, pixelRatio);
+
+        if (!cached.isNull())
+                return cached;
+
+        // The box is compared in device pixels, so an image that fits is
+        // shown with its own pixels instead of being upscaled on high DPI
+        // screens.
+        const QSize deviceBox = box * pixelRatio;
+
+        auto pixmap = image;
+
+        if (image.width() > deviceBox.width() || image.height() > deviceBox.height()) {
+                const auto size =
+                  image.size().scaled(deviceBox, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+
+                pixmap = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+
+        pixmap.setDevicePixelRatio(pixelRatio);
+
+        if (!mediaId.isEmpty()) {
+                const qint64 bytes =
+                  static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+
+                // Pixmaps larger than the whole budget aren't cached.
+                pixmaps_.insert(key(mediaId, box, pixelRatio),
+                                new QPixmap(pixmap),
+                                static_cast<int>(qMin<qint64>(bytes / 1024, MaxCost + 1)));
+        }
+
+        return pixmap;
+}
+
+void
+ImageCache::clear()
+{
+        pixmaps_.clear();
+}
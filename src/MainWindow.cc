@@ -29,7 +29,9 @@
 #include "MatrixClient.h"
 #include "OverlayModal.h"
 #include "RegisterPage.h"
+#include "Session.h"
 #include "SnackBar.h"
+#include "StartupProfiler.h"
 #include "TrayIcon.h"
 #include "UserSettingsPage.h"
 #include "WelcomePage.h"
@@ -115,16 +117,15 @@ MainWindow::MainWindow(QWidget *parent)
                 chat_page_->showQuickSwitcher();
         });
 
-        QSettings settings;
-
         trayIcon_->setVisible(userSettings_->isTrayEnabled());
 
         if (hasActiveUser()) {
-                QString token       = settings.value("auth/access_token").toString();
-                QString home_server = settings.value("auth/home_server").toString();
-                QString user_id     = settings.value("auth/user_id").toString();
+                const auto session = Session::instance();
 
-                showChatPage(user_id, home_server, token);
+                showChatPage(session->userId(), session->homeServer(), session->accessToken());
+        } else {
+                // Nothing else to load, the welcome page is the content.
+                StartupProfiler::finishOnPaint(this);
         }
 }
 
@@ -154,6 +155,9 @@ MainWindow::saveCurrentWindowSize()
 void
 MainWindow::removeOverlayProgressBar()
 {
+        StartupProfiler::mark("Content loaded");
+        StartupProfiler::finishOnPaint(chat_page_);
+
         QTimer *timer = new QTimer(this);
         timer->setSingleShot(true);
 
@@ -185,10 +189,7 @@ MainWindow::removeOverlayProgressBar()
 void
 MainWindow::showChatPage(QString userid, QString homeserver, QString token)
 {
-        QSettings settings;
-        settings.setValue("auth/access_token", token);
-        settings.setValue("auth/home_server", homeserver);
-        settings.setValue("auth/user_id", userid);
+        Session::instance()->setLogin(userid, homeserver, token);
 
         int modalOpacityDuration = 300;
 
@@ -275,10 +276,7 @@ MainWindow::iconActivated(QSystemTrayIcon::ActivationReason reason)
 bool
 MainWindow::hasActiveUser()
 {
-        QSettings settings;
-
-        return settings.contains("auth/access_token") && settings.contains("auth/home_server") &&
-               settings.contains("auth/user_id");
+        return Session::instance()->hasActiveUser();
 }
 
 MainWindow *
@@ -15,8 +15,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QApplication>
 #include <QDebug>
+#include <QDesktopWidget>
 #include <QFile>
+#include <QFutureWatcher>
 #include <QImageReader>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -24,13 +27,20 @@
 #include <QMimeDatabase>
 #include <QNetworkReply>
 #include <QNetworkRequest>
-#include <QPixmap>
-#include <QSettings>
+#include <QThreadPool>
 #include <QUrlQuery>
+#include <QtConcurrent>
 
+#include "Config.h"
 #include "Login.h"
 #include "MatrixClient.h"
 #include "Register.h"
+#include "Session.h"
+#include "Utils.h"
+
+// Image decoding has its own pool so that a burst of downloads doesn't hold up
+// the work queued on the global one.
+Q_GLOBAL_STATIC(QThreadPool, decoderPool)
 
 MatrixClient::MatrixClient(QString server, QObject *parent)
   : QNetworkAccessManager(parent)
@@ -38,9 +48,6 @@ MatrixClient::MatrixClient(QString server, QObject *parent)
   , mediaApiUrl_{"/_matrix/media/r0"}
   , server_{"https://" + server}
 {
-        QSettings settings;
-        txn_id_ = settings.value("client/transaction_id", 1).toInt();
-
         connect(this,
                 &QNetworkAccessManager::networkAccessibleChanged,
                 this,
@@ -56,8 +63,12 @@ MatrixClient::reset() noexcept
         next_batch_.clear();
         server_.clear();
         token_.clear();
+}
 
-        txn_id_ = 0;
+int
+MatrixClient::incrementTransactionId()
+{
+        return Session::instance()->nextTransactionId();
 }
 
 void
@@ -358,7 +369,11 @@ MatrixClient::initialSync() noexcept
 
                 try {
                         mtx::responses::Sync response = nlohmann::json::parse(reply->readAll());
-                        emit initialSyncCompleted(response);
+
+                        // The initial sync is processed incrementally, so it has
+                        // to outlive this handler.
+                        emit initialSyncCompleted(
+                          QSharedPointer<mtx::responses::Sync>::create(std::move(response)));
                 } catch (std::exception &e) {
                         qWarning() << "Sync malformed response" << e.what();
                         return;
@@ -407,10 +422,7 @@ MatrixClient::versions() noexcept
 void
 MatrixClient::getOwnProfile() noexcept
 {
-        // FIXME: Remove settings from the matrix client. The class should store the
-        // user's matrix ID.
-        QSettings settings;
-        auto userid = settings.value("auth/user_id", "").toString();
+        const auto &userid = Session::instance()->userId();
 
         QUrlQuery query;
         query.addQueryItem("access_token", token_);
@@ -447,24 +459,13 @@ MatrixClient::getOwnProfile() noexcept
 void
 MatrixClient::fetchRoomAvatar(const QString &roomid, const QUrl &avatar_url)
 {
-        QList<QString> url_parts = avatar_url.toString().split("mxc://");
+        const auto endpoint = avatarThumbnailUrl(avatar_url, conf::roomlist::avatarSize);
 
-        if (url_parts.size() != 2) {
+        if (!endpoint.isValid()) {
                 qDebug() << "Invalid format for room avatar " << avatar_url.toString();
                 return;
         }
 
-        QUrlQuery query;
-        query.addQueryItem("width", "512");
-        query.addQueryItem("height", "512");
-        query.addQueryItem("method", "crop");
-
-        QString media_url =
-          QString("%1/_matrix/media/r0/thumbnail/%2").arg(getHomeServer().toString(), url_parts[1]);
-
-        QUrl endpoint(media_url);
-        endpoint.setQuery(query);
-
         QNetworkRequest avatar_request(endpoint);
 
         QNetworkReply *reply = get(avatar_request);
@@ -483,34 +484,23 @@ MatrixClient::fetchRoomAvatar(const QString &roomid, const QUrl &avatar_url)
                 if (img.size() == 0)
                         return;
 
-                QPixmap pixmap;
-                pixmap.loadFromData(img);
-
-                emit roomAvatarRetrieved(roomid, pixmap);
+                const auto size = QSize(conf::roomlist::avatarSize, conf::roomlist::avatarSize);
+                decodeImage(img, size, this, [this, roomid](const QImage &image) {
+                        emit roomAvatarRetrieved(roomid, image);
+                });
         });
 }
 
 void
 MatrixClient::fetchUserAvatar(const QString &userId, const QUrl &avatarUrl)
 {
-        QList<QString> url_parts = avatarUrl.toString().split("mxc://");
+        const auto endpoint = avatarThumbnailUrl(avatarUrl, conf::timeline::avatarSize);
 
-        if (url_parts.size() != 2) {
+        if (!endpoint.isValid()) {
                 qDebug() << "Invalid format for user avatar " << avatarUrl.toString();
                 return;
         }
 
-        QUrlQuery query;
-        query.addQueryItem("width", "128");
-        query.addQueryItem("height", "128");
-        query.addQueryItem("method", "crop");
-
-        QString media_url =
-          QString("%1/_matrix/media/r0/thumbnail/%2").arg(getHomeServer().toString(), url_parts[1]);
-
-        QUrl endpoint(media_url);
-        endpoint.setQuery(query);
-
         QNetworkRequest avatar_request(endpoint);
 
         auto reply = get(avatar_request);
@@ -529,22 +519,29 @@ MatrixClient::fetchUserAvatar(const QString &userId, const QUrl &avatarUrl)
                 if (data.size() == 0)
                         return;
 
-                QImage img;
-                img.loadFromData(data);
-
-                emit userAvatarRetrieved(userId, img);
+                const auto size = QSize(conf::timeline::avatarSize, conf::timeline::avatarSize);
+                decodeImage(data, size, this, [this, userId](const QImage &image) {
+                        emit userAvatarRetrieved(userId, image);
+                });
         });
 }
 
 void
-MatrixClient::downloadImage(const QString &event_id, const QUrl &url)
+MatrixClient::downloadImage(const QUrl &url, QObject *receiver, ImageCallback callback)
 {
         QNetworkRequest image_request(url);
 
+        QPointer<QObject> context(receiver);
+
         auto reply = get(image_request);
-        connect(reply, &QNetworkReply::finished, this, [this, reply, event_id]() {
+        abortWithReceiver(reply, receiver);
+
+        connect(reply, &QNetworkReply::finished, this, [this, reply, context, callback]() {
                 reply->deleteLater();
 
+                if (context.isNull())
+                        return;
+
                 int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
                 if (status == 0 || status >= 400) {
@@ -557,22 +554,65 @@ MatrixClient::downloadImage(const QString &event_id, const QUrl &url)
                 if (img.size() == 0)
                         return;
 
-                QPixmap pixmap;
-                pixmap.loadFromData(img);
+                // The original is only ever displayed in the fullscreen
+                // overlay, so there is no point in keeping more pixels than
+                // the screen can show.
+                const auto size = QApplication::desktop()->availableGeometry().size();
+                decodeImage(img, size, context, callback);
+        });
+}
+
+void
+MatrixClient::downloadThumbnail(const QUrl &url,
+                                const QSize &size,
+                                QObject *receiver,
+                                ImageCallback callback)
+{
+        QNetworkRequest thumbnail_request(url);
+
+        QPointer<QObject> context(receiver);
+
+        auto reply = get(thumbnail_request);
+        abortWithReceiver(reply, receiver);
+
+        connect(reply, &QNetworkReply::finished, this, [this, reply, size, context, callback]() {
+                reply->deleteLater();
+
+                if (context.isNull())
+                        return;
+
+                int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+                if (status == 0 || status >= 400) {
+                        qWarning() << reply->errorString();
+                        return;
+                }
+
+                auto img = reply->readAll();
+
+                if (img.size() == 0)
+                        return;
 
-                emit imageDownloaded(event_id, pixmap);
+                decodeImage(img, size, context, callback);
         });
 }
 
 void
-MatrixClient::downloadFile(const QString &event_id, const QUrl &url)
+MatrixClient::downloadFile(const QUrl &url, QObject *receiver, FileCallback callback)
 {
         QNetworkRequest fileRequest(url);
 
+        QPointer<QObject> context(receiver);
+
         auto reply = get(fileRequest);
-        connect(reply, &QNetworkReply::finished, this, [this, reply, event_id]() {
+        abortWithReceiver(reply, receiver);
+
+        connect(reply, &QNetworkReply::finished, this, [reply, context, callback]() {
                 reply->deleteLater();
 
+                if (context.isNull())
+                        return;
+
                 int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
                 if (status == 0 || status >= 400) {
@@ -586,31 +626,20 @@ MatrixClient::downloadFile(const QString &event_id, const QUrl &url)
                 if (data.size() == 0)
                         return;
 
-                emit fileDownloaded(event_id, data);
+                callback(data);
         });
 }
 
 void
 MatrixClient::fetchOwnAvatar(const QUrl &avatar_url)
 {
-        QList<QString> url_parts = avatar_url.toString().split("mxc://");
+        const auto endpoint = avatarThumbnailUrl(avatar_url, conf::userInfoWidget::avatarSize);
 
-        if (url_parts.size() != 2) {
+        if (!endpoint.isValid()) {
                 qDebug() << "Invalid format for media " << avatar_url.toString();
                 return;
         }
 
-        QUrlQuery query;
-        query.addQueryItem("width", "512");
-        query.addQueryItem("height", "512");
-        query.addQueryItem("method", "crop");
-
-        QString media_url =
-          QString("%1/_matrix/media/r0/thumbnail/%2").arg(getHomeServer().toString(), url_parts[1]);
-
-        QUrl endpoint(media_url);
-        endpoint.setQuery(query);
-
         QNetworkRequest avatar_request(endpoint);
 
         auto reply = get(avatar_request);
@@ -629,15 +658,20 @@ MatrixClient::fetchOwnAvatar(const QUrl &avatar_url)
                 if (img.size() == 0)
                         return;
 
-                QPixmap pixmap;
-                pixmap.loadFromData(img);
-
-                emit ownAvatarRetrieved(pixmap);
+                const auto size =
+                  QSize(conf::userInfoWidget::avatarSize, conf::userInfoWidget::avatarSize);
+                decodeImage(img, size, this, [this](const QImage &image) {
+                        emit ownAvatarRetrieved(image);
+                });
         });
 }
 
 void
-MatrixClient::messages(const QString &roomid, const QString &from_token, int limit) noexcept
+MatrixClient::messages(const QString &roomid,
+                       const QString &from_token,
+                       QObject *receiver,
+                       MessagesCallback callback,
+                       int limit) noexcept
 {
         QUrlQuery query;
         query.addQueryItem("access_token", token_);
@@ -651,10 +685,17 @@ MatrixClient::messages(const QString &roomid, const QString &from_token, int lim
 
         QNetworkRequest request(QString(endpoint.toEncoded()));
 
+        QPointer<QObject> context(receiver);
+
         auto reply = get(request);
-        connect(reply, &QNetworkReply::finished, this, [this, reply, roomid]() {
+        abortWithReceiver(reply, receiver);
+
+        connect(reply, &QNetworkReply::finished, this, [reply, roomid, context, callback]() {
                 reply->deleteLater();
 
+                if (context.isNull())
+                        return;
+
                 int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
                 if (status == 0 || status >= 400) {
@@ -666,7 +707,7 @@ MatrixClient::messages(const QString &roomid, const QString &from_token, int lim
                         mtx::responses::Messages messages =
                           nlohmann::json::parse(reply->readAll().data());
 
-                        emit messagesRetrieved(roomid, messages);
+                        callback(messages);
                 } catch (std::exception &e) {
                         qWarning() << "Room messages from" << roomid << e.what();
                         return;
@@ -863,8 +904,7 @@ MatrixClient::leaveRoom(const QString &roomId)
 void
 MatrixClient::sendTypingNotification(const QString &roomid, int timeoutInMillis)
 {
-        QSettings settings;
-        QString user_id = settings.value("auth/user_id").toString();
+        const auto &user_id = Session::instance()->userId();
 
         QUrlQuery query;
         query.addQueryItem("access_token", token_);
@@ -888,8 +928,7 @@ MatrixClient::sendTypingNotification(const QString &roomid, int timeoutInMillis)
 void
 MatrixClient::removeTypingNotification(const QString &roomid)
 {
-        QSettings settings;
-        QString user_id = settings.value("auth/user_id").toString();
+        const auto &user_id = Session::instance()->userId();
 
         QUrlQuery query;
         query.addQueryItem("access_token", token_);
@@ -938,6 +977,50 @@ MatrixClient::readEvent(const QString &room_id, const QString &event_id)
         });
 }
 
+QUrl
+MatrixClient::avatarThumbnailUrl(const QUrl &avatar_url, int size) const
+{
+        const auto method = utils::ThumbnailMethod::Crop;
+        const auto thumbnailSize =
+          utils::thumbnailSize(QSize(size, size), qApp->devicePixelRatio(), method);
+
+        return utils::mediaThumbnailUrl(server_, avatar_url.toString(), thumbnailSize, method);
+}
+
+void
+MatrixClient::decodeImage(const QByteArray &data,
+                          const QSize &size,
+                          QObject *receiver,
+                          ImageCallback callback)
+{
+        const auto maxSize = size * qApp->devicePixelRatio();
+
+        // The watcher is owned by the receiver, so the callback is dropped if
+        // the receiver is destroyed while the image is being decoded.
+        auto watcher = new QFutureWatcher<QImage>(receiver);
+        connect(watcher, &QFutureWatcher<QImage>::finished, watcher, [watcher, callback]() {
+                watcher->deleteLater();
+
+                const auto image = watcher->result();
+
+                if (!image.isNull())
+                        callback(image);
+        });
+
+        watcher->setFuture(QtConcurrent::run(decoderPool(), &utils::decodeImage, data, maxSize));
+}
+
+void
+MatrixClient::abortWithReceiver(QNetworkReply *reply, QObject *receiver)
+{
+        if (!receiver)
+                return;
+
+        auto connection = connect(receiver, &QObject::destroyed, reply, &QNetworkReply::abort);
+
+        connect(reply, &QNetworkReply::finished, this, [connection]() { disconnect(connection); });
+}
+
 QNetworkReply *
 MatrixClient::makeUploadRequest(const QString &filename)
 {
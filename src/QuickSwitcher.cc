@@ -20,6 +20,7 @@
 #include <QTimer>
 
 #include "QuickSwitcher.h"
+#include "RoomSearchIndex.h"
 
 RoomSearchInput::RoomSearchInput(QWidget *parent)
   : TextField(parent)
@@ -56,8 +57,9 @@ RoomSearchInput::hideEvent(QHideEvent *event)
         TextField::hideEvent(event);
 }
 
-QuickSwitcher::QuickSwitcher(QWidget *parent)
+QuickSwitcher::QuickSwitcher(const RoomSearchIndex *index, QWidget *parent)
   : QFrame(parent)
+  , index_{index}
 {
         setMaximumWidth(450);
         setStyleSheet("background-color: white");
@@ -69,32 +71,18 @@ QuickSwitcher::QuickSwitcher(QWidget *parent)
         roomSearch_->setFont(font);
         roomSearch_->setPlaceholderText(tr("Find a room..."));
 
-        completer_ = new QCompleter();
-        completer_->setCaseSensitivity(Qt::CaseInsensitive);
-        completer_->setCompletionMode(QCompleter::PopupCompletion);
+        // The results are already filtered and ranked by the index, so the
+        // completer only displays them.
+        results_   = new QStringListModel(this);
+        completer_ = new QCompleter(results_, this);
+        completer_->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
         completer_->setWidget(this);
 
         topLayout_ = new QVBoxLayout(this);
         topLayout_->addWidget(roomSearch_);
 
         connect(completer_, SIGNAL(highlighted(QString)), roomSearch_, SLOT(setText(QString)));
-        connect(roomSearch_, &QLineEdit::textEdited, this, [=](const QString &prefix) {
-                if (prefix.isEmpty()) {
-                        completer_->popup()->hide();
-                        selection_ = -1;
-                        return;
-                }
-
-                if (prefix != completer_->completionPrefix()) {
-                        completer_->setCompletionPrefix(prefix);
-                        selection_ = -1;
-                }
-
-                completer_->popup()->setWindowFlags(completer_->popup()->windowFlags() |
-                                                    Qt::ToolTip | Qt::NoDropShadowWindowHint);
-                completer_->popup()->setAttribute(Qt::WA_ShowWithoutActivating);
-                completer_->complete();
-        });
+        connect(roomSearch_, &QLineEdit::textEdited, this, &QuickSwitcher::search);
 
         connect(roomSearch_, &RoomSearchInput::selectNextCompletion, this, [=]() {
                 selection_ += 1;
@@ -123,27 +111,40 @@ QuickSwitcher::QuickSwitcher(QWidget *parent)
         connect(roomSearch_, &QLineEdit::returnPressed, this, [=]() {
                 emit closing();
 
-                QString text("");
+                // The best match is picked if none is highlighted.
+                const int row = selection_ == -1 ? 0 : selection_;
 
-                if (selection_ == -1) {
-                        completer_->setCurrentRow(0);
-                        text = completer_->currentCompletion();
-                } else {
-                        text = this->roomSearch_->text().trimmed();
-                }
-                emit roomSelected(rooms_[text]);
+                if (row < roomIds_.size())
+                        emit roomSelected(roomIds_[row]);
 
                 roomSearch_->clear();
         });
 }
 
 void
-QuickSwitcher::setRoomList(const QMap<QString, QString> &rooms)
+QuickSwitcher::search(const QString &query)
 {
-        rooms_            = rooms;
-        QStringList items = rooms.keys();
+        selection_ = -1;
+        roomIds_.clear();
+
+        QStringList items;
+
+        for (const auto &result : index_->search(query, MaxResults)) {
+                items << QString("%1 (%2)").arg(result.name, result.deambiguator);
+                roomIds_ << result.roomId;
+        }
+
+        results_->setStringList(items);
+
+        if (items.isEmpty()) {
+                completer_->popup()->hide();
+                return;
+        }
 
-        completer_->setModel(new QStringListModel(items));
+        completer_->popup()->setWindowFlags(completer_->popup()->windowFlags() | Qt::ToolTip |
+                                            Qt::NoDropShadowWindowHint);
+        completer_->popup()->setAttribute(Qt::WA_ShowWithoutActivating);
+        completer_->complete();
 }
 
 void
@@ -15,82 +15,78 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QMouseEvent>
+#include <algorithm>
+
 #include <QPainter>
+#include <QPainterPath>
 
 #include "Config.h"
-#include "Menu.h"
-#include "Ripple.h"
-#include "RippleOverlay.h"
 #include "RoomInfoListItem.h"
-#include "RoomSettings.h"
+#include "RoomListModel.h"
+#include "RoomListView.h"
 #include "Theme.h"
 
-RoomInfoListItem::RoomInfoListItem(QSharedPointer<RoomSettings> settings,
-                                   RoomState state,
-                                   QString room_id,
-                                   QWidget *parent)
-  : QWidget(parent)
-  , state_(state)
-  , roomId_(room_id)
-  , roomSettings_{settings}
-  , isPressed_(false)
-  , maxHeight_(IconSize + 2 * Padding)
-  , unreadMsgCount_(0)
-{
-        setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-        setMouseTracking(true);
-        setAttribute(Qt::WA_Hover);
-
-        setFixedHeight(maxHeight_);
+RoomInfoListItem::RoomInfoListItem(RoomListView *view)
+  : QStyledItemDelegate(view)
+  , view_(view)
+{}
 
-        QPainterPath path;
-        path.addRect(0, 0, parent->width(), height());
+QSize
+RoomInfoListItem::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &) const
+{
+        return QSize(option.rect.width(), Height);
+}
 
-        ripple_overlay_ = new RippleOverlay(this);
-        ripple_overlay_->setClipPath(path);
-        ripple_overlay_->setClipping(true);
+QPixmap
+RoomInfoListItem::avatarPixmap(const QImage &img, qreal pixelRatio)
+{
+        const int side = qRound(IconSize * pixelRatio);
 
-        menu_ = new Menu(this);
+        QPixmap pixmap(side, side);
+        pixmap.fill(Qt::transparent);
 
-        toggleNotifications_ = new QAction(notificationText(), this);
-        connect(toggleNotifications_, &QAction::triggered, this, [=]() {
-                roomSettings_->toggleNotifications();
-        });
+        QPainter p(&pixmap);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(Qt::NoPen);
+        p.setBrush(img.scaled(side, side, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        p.drawEllipse(0, 0, side, side);
+        p.end();
 
-        leaveRoom_ = new QAction(tr("Leave room"), this);
-        connect(leaveRoom_, &QAction::triggered, this, [=]() { emit leaveRoom(room_id); });
+        pixmap.setDevicePixelRatio(pixelRatio);
 
-        menu_->addAction(toggleNotifications_);
-        menu_->addAction(leaveRoom_);
+        return pixmap;
 }
 
-QString
-RoomInfoListItem::notificationText()
+void
+RoomInfoListItem::paint(QPainter *painter,
+                        const QStyleOptionViewItem &option,
+                        const QModelIndex &index) const
 {
-        if (roomSettings_.isNull() || roomSettings_->isNotificationsEnabled())
-                return QString(tr("Disable notifications"));
+        auto roomList = qobject_cast<const RoomListModel *>(index.model());
 
-        return tr("Enable notifications");
-}
+        if (roomList == nullptr)
+                return;
 
-void
-RoomInfoListItem::resizeEvent(QResizeEvent *)
-{
-        // Update ripple's clipping path.
-        QPainterPath path;
-        path.addRect(0, 0, width(), height());
+        // Avatars are fetched the first time their room is painted.
+        if (auto model = qobject_cast<RoomListModel *>(view_->model()))
+                model->requestAvatar(index.row());
 
-        ripple_overlay_->setClipPath(path);
-        ripple_overlay_->setClipping(true);
-}
+        const auto &room    = roomList->room(index.row());
+        const auto &state   = room.state;
+        const auto &lastMsg = room.lastMessage;
 
-void
-RoomInfoListItem::paintEvent(QPaintEvent *event)
-{
-        Q_UNUSED(event);
+        const bool isPressed  = option.state & QStyle::State_Selected;
+        const bool isHovered  = option.state & QStyle::State_MouseOver;
+        const int width       = option.rect.width();
+        const int height      = option.rect.height();
+        const int unreadCount = room.unreadCount;
+
+        // The row is painted in its own coordinates.
+        QPainter &p = *painter;
+        p.save();
+        p.translate(option.rect.topLeft());
+        p.setClipRect(QRect(0, 0, width, height));
 
-        QPainter p(this);
         p.setRenderHint(QPainter::TextAntialiasing);
         p.setRenderHint(QPainter::SmoothPixmapTransform);
         p.setRenderHint(QPainter::Antialiasing);
@@ -99,27 +95,25 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
         font.setPixelSize(conf::fontSize);
         QFontMetrics metrics(font);
 
-        if (isPressed_) {
-                p.fillRect(rect(), highlightedBackgroundColor_);
-        } else if (underMouse()) {
-                p.fillRect(rect(), hoverBackgroundColor_);
+        if (isPressed) {
+                p.fillRect(0, 0, width, height, view_->highlightedBackgroundColor());
+        } else if (isHovered) {
+                p.fillRect(0, 0, width, height, view_->hoverBackgroundColor());
         } else {
-                p.fillRect(rect(), backgroundColor_);
+                p.fillRect(0, 0, width, height, view_->backgroundColor());
         }
 
-        // p.setPen(QColor("#333"));
-
         QRect avatarRegion(Padding, Padding, IconSize, IconSize);
 
         // Description line with the default font.
-        int bottom_y = maxHeight_ - Padding - Padding / 3 - metrics.ascent() / 2;
+        int bottom_y = Height - Padding - Padding / 3 - metrics.ascent() / 2;
 
-        if (width() > ui::sidebar::SmallSize) {
-                if (isPressed_) {
-                        QPen pen(highlightedTitleColor_);
+        if (width > ui::sidebar::SmallSize) {
+                if (isPressed) {
+                        QPen pen(view_->highlightedTitleColor());
                         p.setPen(pen);
                 } else {
-                        QPen pen(titleColor_);
+                        QPen pen(view_->titleColor());
                         p.setPen(pen);
                 }
                 font.setPixelSize(conf::roomlist::fonts::heading);
@@ -130,28 +124,27 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
                 int top_y = 2 * Padding + fontNameMetrics.ascent() / 2;
 
                 auto name = metrics.elidedText(
-                  state_.getName(), Qt::ElideRight, (width() - IconSize - 2 * Padding) * 0.8);
+                  state.getName(), Qt::ElideRight, (width - IconSize - 2 * Padding) * 0.8);
                 p.drawText(QPoint(2 * Padding + IconSize, top_y), name);
 
-                if (isPressed_) {
-                        QPen pen(highlightedSubtitleColor_);
+                if (isPressed) {
+                        QPen pen(view_->highlightedSubtitleColor());
                         p.setPen(pen);
                 } else {
-                        QPen pen(subtitleColor_);
+                        QPen pen(view_->subtitleColor());
                         p.setPen(pen);
                 }
 
                 font.setPixelSize(conf::fontSize);
                 p.setFont(font);
 
-                auto msgStampWidth = QFontMetrics(font).width(lastMsgInfo_.timestamp) + 5;
+                auto msgStampWidth = QFontMetrics(font).width(lastMsg.timestamp) + 5;
 
                 // The limit is the space between the end of the avatar and the start of the
                 // timestamp.
                 int usernameLimit =
-                  std::max(0, width() - 3 * Padding - msgStampWidth - IconSize - 20);
-                auto userName =
-                  metrics.elidedText(lastMsgInfo_.username, Qt::ElideRight, usernameLimit);
+                  std::max(0, width - 3 * Padding - msgStampWidth - IconSize - 20);
+                auto userName = metrics.elidedText(lastMsg.username, Qt::ElideRight, usernameLimit);
 
                 font.setBold(true);
                 p.setFont(font);
@@ -165,16 +158,16 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
                 // The limit is the space between the end of the username and the start of
                 // the timestamp.
                 int descriptionLimit =
-                  std::max(0, width() - 3 * Padding - msgStampWidth - IconSize - nameWidth - 5);
+                  std::max(0, width - 3 * Padding - msgStampWidth - IconSize - nameWidth - 5);
                 auto description =
-                  metrics.elidedText(lastMsgInfo_.body, Qt::ElideRight, descriptionLimit);
+                  metrics.elidedText(lastMsg.body, Qt::ElideRight, descriptionLimit);
                 p.drawText(QPoint(2 * Padding + IconSize + nameWidth, bottom_y), description);
 
                 // We either show the bubble or the last message timestamp.
-                if (unreadMsgCount_ == 0) {
+                if (unreadCount == 0) {
                         font.setBold(true);
-                        p.drawText(QPoint(width() - Padding - msgStampWidth, bottom_y),
-                                   lastMsgInfo_.timestamp);
+                        p.drawText(QPoint(width - Padding - msgStampWidth, bottom_y),
+                                   lastMsg.timestamp);
                 }
         }
 
@@ -182,7 +175,7 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
         p.setPen(Qt::NoPen);
 
         // We using the first letter of room's name.
-        if (roomAvatar_.isNull()) {
+        if (room.avatar.isNull()) {
                 QBrush brush;
                 brush.setStyle(Qt::SolidPattern);
                 brush.setColor("#eee");
@@ -197,19 +190,13 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
                 p.setPen(QColor("#333"));
                 p.setBrush(Qt::NoBrush);
                 p.drawText(
-                  avatarRegion.translated(0, -1), Qt::AlignCenter, QChar(state_.getName()[0]));
+                  avatarRegion.translated(0, -1), Qt::AlignCenter, QChar(state.getName()[0]));
         } else {
-                p.save();
-
-                QPainterPath path;
-                path.addEllipse(Padding, Padding, IconSize, IconSize);
-                p.setClipPath(path);
-
-                p.drawPixmap(avatarRegion, roomAvatar_);
-                p.restore();
+                // The avatar has been rendered as a circle beforehand.
+                p.drawPixmap(avatarRegion, room.avatar);
         }
 
-        if (unreadMsgCount_ > 0) {
+        if (unreadCount > 0) {
                 QColor textColor("white");
                 QColor backgroundColor("#38A3D8");
 
@@ -217,7 +204,7 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
                 brush.setStyle(Qt::SolidPattern);
                 brush.setColor(backgroundColor);
 
-                if (isPressed_)
+                if (isPressed)
                         brush.setColor(textColor);
 
                 QFont unreadCountFont;
@@ -231,108 +218,22 @@ RoomInfoListItem::paintEvent(QPaintEvent *event)
                 int diameter = 20;
 
                 QRectF r(
-                  width() - diameter - Padding, bottom_y - diameter / 2 - 5, diameter, diameter);
+                  width - diameter - Padding, bottom_y - diameter / 2 - 5, diameter, diameter);
 
-                if (width() == ui::sidebar::SmallSize)
-                        r = QRectF(
-                          width() - diameter - 5, height() - diameter - 5, diameter, diameter);
+                if (width == ui::sidebar::SmallSize)
+                        r = QRectF(width - diameter - 5, height - diameter - 5, diameter, diameter);
 
                 p.setPen(Qt::NoPen);
                 p.drawEllipse(r);
 
                 p.setPen(QPen(textColor));
 
-                if (isPressed_)
+                if (isPressed)
                         p.setPen(QPen(backgroundColor));
 
                 p.setBrush(Qt::NoBrush);
-                p.drawText(
-                  r.translated(0, -0.5), Qt::AlignCenter, QString::number(unreadMsgCount_));
+                p.drawText(r.translated(0, -0.5), Qt::AlignCenter, QString::number(unreadCount));
         }
-}
-
-void
-RoomInfoListItem::updateUnreadMessageCount(int count)
-{
-        unreadMsgCount_ += count;
-        update();
-}
 
-void
-RoomInfoListItem::clearUnreadMessageCount()
-{
-        unreadMsgCount_ = 0;
-        update();
+        p.restore();
 }
-
-void
-RoomInfoListItem::setPressedState(bool state)
-{
-        if (!isPressed_ && state) {
-                isPressed_ = state;
-                update();
-        } else if (isPressed_ && !state) {
-                isPressed_ = state;
-                update();
-        }
-}
-
-void
-RoomInfoListItem::setState(const RoomState &new_state)
-{
-        state_ = new_state;
-        update();
-}
-
-void
-RoomInfoListItem::contextMenuEvent(QContextMenuEvent *event)
-{
-        Q_UNUSED(event);
-
-        toggleNotifications_->setText(notificationText());
-        menu_->popup(event->globalPos());
-}
-
-void
-RoomInfoListItem::mousePressEvent(QMouseEvent *event)
-{
-        if (event->buttons() == Qt::RightButton) {
-                QWidget::mousePressEvent(event);
-                return;
-        }
-
-        emit clicked(roomId_);
-
-        setPressedState(true);
-
-        // Ripple on mouse position by default.
-        QPoint pos           = event->pos();
-        qreal radiusEndValue = static_cast<qreal>(width()) / 3;
-
-        Ripple *ripple = new Ripple(pos);
-
-        ripple->setRadiusEndValue(radiusEndValue);
-        ripple->setOpacityStartValue(0.15);
-        ripple->setColor(QColor("white"));
-        ripple->radiusAnimation()->setDuration(200);
-        ripple->opacityAnimation()->setDuration(400);
-
-        ripple_overlay_->addRipple(ripple);
-}
-
-void
-RoomInfoListItem::setAvatar(const QImage &img)
-{
-        roomAvatar_ = QPixmap::fromImage(
-          img.scaled(IconSize, IconSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-        update();
-}
-
-void
-RoomInfoListItem::setDescriptionMessage(const DescInfo &info)
-{
-        lastMsgInfo_ = info;
-        update();
-}
-
-RoomInfoListItem::~RoomInfoListItem() {}
@@ -17,12 +17,16 @@
 
 #include <QDebug>
 #include <QObject>
+#include <QPainter>
+#include <QStyleOption>
 
 #include "MainWindow.h"
 #include "MatrixClient.h"
 #include "OverlayModal.h"
 #include "RoomInfoListItem.h"
 #include "RoomList.h"
+#include "RoomListModel.h"
+#include "RoomListView.h"
 #include "RoomSettings.h"
 #include "RoomState.h"
 
@@ -35,27 +39,25 @@ RoomList::RoomList(QSharedPointer<MatrixClient> client, QWidget *parent)
         topLayout_->setSpacing(0);
         topLayout_->setMargin(0);
 
-        scrollArea_ = new QScrollArea(this);
-        scrollArea_->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-        scrollArea_->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-        scrollArea_->setSizeAdjustPolicy(QAbstractScrollArea::AdjustToContents);
-        scrollArea_->setWidgetResizable(true);
-        scrollArea_->setAlignment(Qt::AlignLeading | Qt::AlignLeft | Qt::AlignVCenter);
+        model_ = new RoomListModel(this);
 
-        scrollAreaContents_ = new QWidget(this);
+        view_ = new RoomListView(this);
+        view_->setModel(model_);
+        topLayout_->addWidget(view_);
 
-        contentsLayout_ = new QVBoxLayout(scrollAreaContents_);
-        contentsLayout_->setSpacing(0);
-        contentsLayout_->setMargin(0);
-        contentsLayout_->addStretch(1);
+        connect(view_, &RoomListView::roomClicked, this, &RoomList::highlightSelectedRoom);
+        connect(view_, &RoomListView::leaveRoom, this, &RoomList::openLeaveRoomDialog);
 
-        scrollArea_->setWidget(scrollAreaContents_);
-        topLayout_->addWidget(scrollArea_);
+        // Only the avatars of the rooms that have been shown are fetched.
+        connect(model_,
+                &RoomListModel::avatarRequested,
+                client_.data(),
+                &MatrixClient::fetchRoomAvatar);
 
         connect(client_.data(),
-                SIGNAL(roomAvatarRetrieved(const QString &, const QPixmap &)),
+                SIGNAL(roomAvatarRetrieved(const QString &, const QImage &)),
                 this,
-                SLOT(updateRoomAvatar(const QString &, const QPixmap &)));
+                SLOT(updateRoomAvatar(const QString &, const QImage &)));
 }
 
 RoomList::~RoomList() {}
@@ -63,7 +65,9 @@ RoomList::~RoomList() {}
 void
 RoomList::clear()
 {
-        rooms_.clear();
+        model_->clear();
+
+        updateTotalUnreadMessageCount(-totalUnreadMessageCount_);
 }
 
 void
@@ -71,63 +75,74 @@ RoomList::addRoom(const QMap<QString, QSharedPointer<RoomSettings>> &settings,
                   const RoomState &state,
                   const QString &room_id)
 {
-        RoomInfoListItem *room_item =
-          new RoomInfoListItem(settings[room_id], state, room_id, scrollArea_);
-        connect(room_item, &RoomInfoListItem::clicked, this, &RoomList::highlightSelectedRoom);
-        connect(room_item, &RoomInfoListItem::leaveRoom, this, &RoomList::openLeaveRoomDialog);
-
-        rooms_.insert(room_id, QSharedPointer<RoomInfoListItem>(room_item));
+        RoomListEntry room;
+        room.roomId   = room_id;
+        room.state    = state;
+        room.settings = settings[room_id];
 
-        if (!state.getAvatar().toString().isEmpty())
-                client_->fetchRoomAvatar(room_id, state.getAvatar());
-
-        int pos = contentsLayout_->count() - 1;
-        contentsLayout_->insertWidget(pos, room_item);
+        model_->addRoom(room);
 }
 
 void
 RoomList::removeRoom(const QString &room_id, bool reset)
 {
-        rooms_.remove(room_id);
+        if (auto room = model_->room(room_id))
+                updateTotalUnreadMessageCount(-room->unreadCount);
+
+        model_->removeRoom(room_id);
 
-        if (rooms_.isEmpty() || !reset)
+        if (model_->rowCount() == 0 || !reset)
                 return;
 
-        auto first_room = rooms_.first();
-        first_room->setPressedState(true);
+        selectFirstRoom();
+}
 
-        emit roomChanged(rooms_.firstKey());
+const RoomSearchIndex &
+RoomList::searchIndex() const
+{
+        return model_->searchIndex();
+}
+
+void
+RoomList::selectFirstRoom()
+{
+        const auto first_room = model_->index(0);
+
+        view_->setSelectedRoom(first_room);
+
+        emit roomChanged(first_room.data(RoomListModel::RoomIdRole).toString());
 }
 
 void
 RoomList::updateUnreadMessageCount(const QString &roomid, int count)
 {
-        if (!rooms_.contains(roomid)) {
+        if (!model_->contains(roomid)) {
                 qWarning() << "UpdateUnreadMessageCount: Unknown roomid";
                 return;
         }
 
-        rooms_[roomid]->updateUnreadMessageCount(count);
+        model_->addUnreadCount(roomid, count);
 
-        calculateUnreadMessageCount();
+        updateTotalUnreadMessageCount(count);
 }
 
 void
-RoomList::calculateUnreadMessageCount()
+RoomList::updateTotalUnreadMessageCount(int diff)
 {
-        int total_unread_msgs = 0;
+        if (diff == 0)
+                return;
 
-        for (const auto &room : rooms_)
-                total_unread_msgs += room->unreadMessageCount();
+        totalUnreadMessageCount_ += diff;
 
-        emit totalUnreadMessageCountUpdated(total_unread_msgs);
+        emit totalUnreadMessageCountUpdated(totalUnreadMessageCount_);
 }
 
 void
 RoomList::setInitialRooms(const QMap<QString, QSharedPointer<RoomSettings>> &settings,
-                          const QMap<QString, RoomState> &states)
+                          const QMap<QString, RoomState> &states,
+                          const QMap<QString, DescInfo> &lastMessages)
 {
-        rooms_.clear();
+        clear();
 
         if (settings.size() != states.size()) {
                 qWarning() << "Initializing room list";
@@ -135,20 +150,28 @@ RoomList::setInitialRooms(const QMap<QString, QSharedPointer<RoomSettings>> &set
                 return;
         }
 
+        // All the rooms are added with a single model reset.
+        std::vector<RoomListEntry> rooms;
+        rooms.reserve(states.size());
+
         for (auto it = states.constBegin(); it != states.constEnd(); ++it) {
-                const auto room_id = it.key();
-                const auto state   = it.value();
+                RoomListEntry room;
+                room.roomId   = it.key();
+                room.state    = it.value();
+                room.settings = settings[it.key()];
+
+                if (lastMessages.contains(it.key()))
+                        room.lastMessage = lastMessages.value(it.key());
 
-                addRoom(settings, state, room_id);
+                rooms.push_back(room);
         }
 
-        if (rooms_.isEmpty())
-                return;
+        model_->setRooms(std::move(rooms));
 
-        auto first_room = rooms_.first();
-        first_room->setPressedState(true);
+        if (model_->rowCount() == 0)
+                return;
 
-        emit roomChanged(rooms_.firstKey());
+        selectFirstRoom();
 }
 
 void
@@ -175,41 +198,34 @@ RoomList::openLeaveRoomDialog(const QString &room_id)
 
 void
 RoomList::sync(const QMap<QString, RoomState> &states,
+               const QList<QString> &changedRooms,
                QMap<QString, QSharedPointer<RoomSettings>> &settings)
 
 {
-        for (auto it = states.constBegin(); it != states.constEnd(); ++it) {
-                auto room_id = it.key();
-                auto state   = it.value();
+        for (const auto &room_id : changedRooms) {
+                auto it = states.constFind(room_id);
+
+                if (it == states.constEnd()) {
+                        qWarning() << "RoomList: missing state for changed room" << room_id;
+                        continue;
+                }
+
+                const auto &state = it.value();
 
-                if (!rooms_.contains(room_id)) {
+                if (!model_->contains(room_id)) {
                         settings.insert(room_id,
                                         QSharedPointer<RoomSettings>(new RoomSettings(room_id)));
                         addRoom(settings, state, room_id);
                 }
 
-                auto room = rooms_[room_id];
-
-                auto current_avatar = room->state().getAvatar();
-                auto new_avatar     = state.getAvatar();
-
-                if (current_avatar != new_avatar && !new_avatar.toString().isEmpty())
-                        client_->fetchRoomAvatar(room_id, new_avatar);
-
-                room->setState(state);
+                model_->setState(room_id, state);
         }
 }
 
 void
 RoomList::clearRoomMessageCount(const QString &room_id)
 {
-        if (!rooms_.contains(room_id))
-                return;
-
-        auto room = rooms_[room_id];
-        room->clearUnreadMessageCount();
-
-        calculateUnreadMessageCount();
+        updateTotalUnreadMessageCount(-model_->clearUnreadCount(room_id));
 }
 
 void
@@ -217,46 +233,36 @@ RoomList::highlightSelectedRoom(const QString &room_id)
 {
         emit roomChanged(room_id);
 
-        if (!rooms_.contains(room_id)) {
+        if (!model_->contains(room_id)) {
                 qDebug() << "RoomList: clicked unknown roomid";
                 return;
         }
 
         clearRoomMessageCount(room_id);
 
-        calculateUnreadMessageCount();
-
-        for (auto it = rooms_.constBegin(); it != rooms_.constEnd(); ++it) {
-                if (it.key() != room_id) {
-                        it.value()->setPressedState(false);
-                } else {
-                        it.value()->setPressedState(true);
-                        scrollArea_->ensureWidgetVisible(
-                          qobject_cast<QWidget *>(it.value().data()));
-                }
-        }
+        view_->setSelectedRoom(model_->indexOf(room_id));
 }
 
 void
-RoomList::updateRoomAvatar(const QString &roomid, const QPixmap &img)
+RoomList::updateRoomAvatar(const QString &roomid, const QImage &img)
 {
-        if (!rooms_.contains(roomid)) {
+        if (!model_->contains(roomid)) {
                 qWarning() << "Avatar update on non existent room" << roomid;
                 return;
         }
 
-        rooms_.value(roomid)->setAvatar(img.toImage());
+        model_->setAvatar(roomid, RoomInfoListItem::avatarPixmap(img, devicePixelRatioF()));
 }
 
 void
 RoomList::updateRoomDescription(const QString &roomid, const DescInfo &info)
 {
-        if (!rooms_.contains(roomid)) {
+        if (!model_->contains(roomid)) {
                 qWarning() << "Description update on non existent room" << roomid << info.body;
                 return;
         }
 
-        rooms_.value(roomid)->setDescriptionMessage(info);
+        model_->setLastMessage(roomid, info);
 }
 
 void
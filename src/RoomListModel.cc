@@ -0,0 +1,333 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "RoomListModel.h"
+
+RoomListModel::RoomListModel(QObject *parent)
+  : QAbstractListModel(parent)
+{}
+
+int
+RoomListModel::rowCount(const QModelIndex &parent) const
+{
+        if (parent.isValid())
+                return 0;
+
+        return static_cast<int>(rooms_.size());
+}
+
+QVariant
+RoomListModel::data(const QModelIndex &index, int role) const
+{
+        if (!index.isValid() || index.row() >= rowCount())
+                return QVariant();
+
+        const auto &room = rooms_[index.row()];
+
+        switch (role) {
+        case Qt::DisplayRole:
+                return room.state.getName();
+        case RoomIdRole:
+                return room.roomId;
+        default:
+                return QVariant();
+        }
+}
+
+void
+RoomListModel::setRooms(std::vector<RoomListEntry> rooms)
+{
+        beginResetModel();
+        rooms_ = std::move(rooms);
+        updateKeys();
+
+        searchIndex_.clear();
+
+        for (const auto &room : rooms_) {
+                searchIndex_.insert(room.roomId, room.state);
+                searchIndex_.setLastActivity(room.roomId, keys_.value(room.roomId).lastActivity);
+        }
+
+        std::sort(rooms_.begin(),
+                  rooms_.end(),
+                  [this](const RoomListEntry &a, const RoomListEntry &b) {
+                          return *keys_.constFind(a.roomId) < *keys_.constFind(b.roomId);
+                  });
+        endResetModel();
+}
+
+void
+RoomListModel::addRoom(RoomListEntry room)
+{
+        if (contains(room.roomId))
+                return;
+
+        const auto key = sortKey(room);
+        const int row  = lowerBound(key, 0, rowCount());
+
+        searchIndex_.insert(room.roomId, room.state);
+        searchIndex_.setLastActivity(room.roomId, key.lastActivity);
+
+        beginInsertRows(QModelIndex(), row, row);
+        keys_.insert(room.roomId, key);
+        rooms_.insert(rooms_.begin() + row, std::move(room));
+        endInsertRows();
+}
+
+void
+RoomListModel::removeRoom(const QString &roomId)
+{
+        const int row = rowOf(roomId);
+
+        if (row == -1)
+                return;
+
+        beginRemoveRows(QModelIndex(), row, row);
+        rooms_.erase(rooms_.begin() + row);
+        keys_.remove(roomId);
+        endRemoveRows();
+
+        searchIndex_.remove(roomId);
+}
+
+void
+RoomListModel::clear()
+{
+        setRooms(std::vector<RoomListEntry>());
+}
+
+QModelIndex
+RoomListModel::indexOf(const QString &roomId) const
+{
+        const int row = rowOf(roomId);
+
+        if (row == -1)
+                return QModelIndex();
+
+        return index(row);
+}
+
+const RoomListEntry *
+RoomListModel::room(const QString &roomId) const
+{
+        const int row = rowOf(roomId);
+
+        if (row == -1)
+                return nullptr;
+
+        return &rooms_[row];
+}
+
+RoomListEntry *
+RoomListModel::find(const QString &roomId)
+{
+        const int row = rowOf(roomId);
+
+        if (row == -1)
+                return nullptr;
+
+        return &rooms_[row];
+}
+
+void
+RoomListModel::requestAvatar(int row)
+{
+        if (row < 0 || row >= rowCount())
+                return;
+
+        auto &room = rooms_[row];
+
+        if (room.avatarRequested)
+                return;
+
+        room.avatarRequested = true;
+
+        const auto url = room.state.getAvatar();
+
+        if (!url.toString().isEmpty())
+                emit avatarRequested(room.roomId, url);
+}
+
+void
+RoomListModel::setState(const QString &roomId, const RoomState &state)
+{
+        auto room = find(roomId);
+
+        // A room that was just added already holds this state.
+        if (!room || room->state.version() == state.version())
+                return;
+
+        // The new avatar is fetched when the row is painted again. The old
+        // one is shown until then.
+        if (room->state.getAvatar() != state.getAvatar())
+                room->avatarRequested = false;
+
+        room->state = state;
+        searchIndex_.insert(roomId, state);
+        roomChanged(roomId);
+}
+
+void
+RoomListModel::setAvatar(const QString &roomId, const QPixmap &avatar)
+{
+        if (auto room = find(roomId)) {
+                room->avatar = avatar;
+                roomChanged(roomId);
+        }
+}
+
+void
+RoomListModel::setLastMessage(const QString &roomId, const DescInfo &info)
+{
+        if (auto room = find(roomId)) {
+                room->lastMessage = info;
+                roomChanged(roomId);
+        }
+}
+
+void
+RoomListModel::addUnreadCount(const QString &roomId, int count)
+{
+        if (auto room = find(roomId)) {
+                room->unreadCount += count;
+                roomChanged(roomId);
+        }
+}
+
+int
+RoomListModel::clearUnreadCount(const QString &roomId)
+{
+        auto room = find(roomId);
+
+        if (room == nullptr || room->unreadCount == 0)
+                return 0;
+
+        const int count   = room->unreadCount;
+        room->unreadCount = 0;
+        roomChanged(roomId);
+
+        return count;
+}
+
+bool
+RoomListModel::SortKey::operator<(const SortKey &other) const
+{
+        if (pinned != other.pinned)
+                return pinned;
+
+        if (lastActivity != other.lastActivity)
+                return lastActivity > other.lastActivity;
+
+        return roomId < other.roomId;
+}
+
+RoomListModel::SortKey
+RoomListModel::sortKey(const RoomListEntry &room)
+{
+        const auto &datetime = room.lastMessage.datetime;
+
+        SortKey key;
+        key.pinned       = room.unreadCount > 0;
+        key.lastActivity = datetime.isValid() ? datetime.toMSecsSinceEpoch() : 0;
+        key.roomId       = room.roomId;
+
+        return key;
+}
+
+int
+RoomListModel::lowerBound(const SortKey &key, int first, int last) const
+{
+        // The rooms are compared by the key they have been sorted with, which
+        // is different from their current one while they are being moved.
+        while (first < last) {
+                const int middle = first + (last - first) / 2;
+
+                if (*keys_.constFind(rooms_[middle].roomId) < key)
+                        first = middle + 1;
+                else
+                        last = middle;
+        }
+
+        return first;
+}
+
+int
+RoomListModel::rowOf(const QString &roomId) const
+{
+        auto key = keys_.constFind(roomId);
+
+        if (key == keys_.constEnd())
+                return -1;
+
+        return lowerBound(*key, 0, rowCount());
+}
+
+void
+RoomListModel::roomChanged(const QString &roomId)
+{
+        int row = rowOf(roomId);
+
+        if (row == -1)
+                return;
+
+        const auto oldKey = keys_.value(roomId);
+        const auto newKey = sortKey(rooms_[row]);
+
+        auto first = rooms_.begin();
+
+        if (newKey < oldKey) {
+                const int dest = lowerBound(newKey, 0, row);
+
+                if (dest != row) {
+                        beginMoveRows(QModelIndex(), row, row, QModelIndex(), dest);
+                        std::rotate(first + dest, first + row, first + row + 1);
+                        endMoveRows();
+
+                        row = dest;
+                }
+        } else if (oldKey < newKey) {
+                const int dest = lowerBound(newKey, row + 1, rowCount()) - 1;
+
+                if (dest != row) {
+                        // The destination of a move down is the row after the
+                        // one the room ends up in.
+                        beginMoveRows(QModelIndex(), row, row, QModelIndex(), dest + 1);
+                        std::rotate(first + row, first + row + 1, first + dest + 1);
+                        endMoveRows();
+
+                        row = dest;
+                }
+        }
+
+        keys_.insert(roomId, newKey);
+        searchIndex_.setLastActivity(roomId, newKey.lastActivity);
+
+        const auto idx = index(row);
+        emit dataChanged(idx, idx);
+}
+
+void
+RoomListModel::updateKeys()
+{
+        keys_.clear();
+        keys_.reserve(static_cast<int>(rooms_.size()));
+
+        for (const auto &room : rooms_)
+                keys_.insert(room.roomId, sortKey(room));
+}
@@ -0,0 +1,152 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QMouseEvent>
+#include <QPainterPath>
+
+#include "Menu.h"
+#include "Ripple.h"
+#include "RippleOverlay.h"
+#include "RoomInfoListItem.h"
+#include "RoomListModel.h"
+#include "RoomListView.h"
+#include "RoomSettings.h"
+
+RoomListView::RoomListView(QWidget *parent)
+  : QListView(parent)
+{
+        setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+        setSelectionMode(QAbstractItemView::SingleSelection);
+        setEditTriggers(QAbstractItemView::NoEditTriggers);
+        setFocusPolicy(Qt::NoFocus);
+        setFrameShape(QFrame::NoFrame);
+
+        // All the rows have the same height, so the view can lay out and
+        // find the visible rows without asking the delegate about each one.
+        setUniformItemSizes(true);
+
+        setMouseTracking(true);
+        viewport()->setAttribute(Qt::WA_Hover);
+
+        setItemDelegate(new RoomInfoListItem(this));
+
+        ripple_overlay_ = new RippleOverlay(viewport());
+        ripple_overlay_->setClipping(true);
+
+        menu_ = new Menu(this);
+
+        toggleNotifications_ = new QAction(this);
+        connect(toggleNotifications_, &QAction::triggered, this, [this]() {
+                auto roomList = qobject_cast<RoomListModel *>(model());
+
+                if (!menuIndex_.isValid() || roomList == nullptr)
+                        return;
+
+                const auto &room = roomList->room(menuIndex_.row());
+
+                if (!room.settings.isNull())
+                        room.settings->toggleNotifications();
+        });
+
+        leaveRoom_ = new QAction(tr("Leave room"), this);
+        connect(leaveRoom_, &QAction::triggered, this, [this]() {
+                if (menuIndex_.isValid())
+                        emit leaveRoom(menuIndex_.data(RoomListModel::RoomIdRole).toString());
+        });
+
+        menu_->addAction(toggleNotifications_);
+        menu_->addAction(leaveRoom_);
+}
+
+void
+RoomListView::setSelectedRoom(const QModelIndex &index)
+{
+        if (!index.isValid())
+                return;
+
+        selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
+        scrollTo(index);
+}
+
+QString
+RoomListView::notificationText(const QModelIndex &index) const
+{
+        auto roomList = qobject_cast<RoomListModel *>(model());
+
+        if (roomList == nullptr)
+                return QString();
+
+        const auto &settings = roomList->room(index.row()).settings;
+
+        if (settings.isNull() || settings->isNotificationsEnabled())
+                return QString(tr("Disable notifications"));
+
+        return tr("Enable notifications");
+}
+
+void
+RoomListView::contextMenuEvent(QContextMenuEvent *event)
+{
+        const auto index = indexAt(event->pos());
+
+        if (!index.isValid())
+                return;
+
+        menuIndex_ = index;
+
+        toggleNotifications_->setText(notificationText(index));
+        menu_->popup(event->globalPos());
+}
+
+void
+RoomListView::mousePressEvent(QMouseEvent *event)
+{
+        // The context menu is handled by contextMenuEvent.
+        if (event->button() != Qt::LeftButton)
+                return;
+
+        const auto index = indexAt(event->pos());
+
+        if (!index.isValid())
+                return;
+
+        // The selection follows the active room, which is set by the
+        // receiver of the signal.
+        emit roomClicked(index.data(RoomListModel::RoomIdRole).toString());
+
+        // Ripple on mouse position by default, clipped to the clicked row.
+        const auto row = visualRect(index);
+
+        QPainterPath path;
+        path.addRect(row);
+        ripple_overlay_->setClipPath(path);
+
+        QPoint pos           = event->pos();
+        qreal radiusEndValue = static_cast<qreal>(row.width()) / 3;
+
+        Ripple *ripple = new Ripple(pos);
+
+        ripple->setRadiusEndValue(radiusEndValue);
+        ripple->setOpacityStartValue(0.15);
+        ripple->setColor(QColor("white"));
+        ripple->radiusAnimation()->setDuration(200);
+        ripple->opacityAnimation()->setDuration(400);
+
+        ripple_overlay_->addRipple(ripple);
+}
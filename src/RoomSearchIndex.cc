@@ -0,0 +1,293 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "RoomSearchIndex.h"
+#include "RoomState.h"
+#include "Session.h"
+
+namespace {
+// Rank of each kind of match. A room's score is the rank of its best match
+// plus a bonus within the rank, so a worse kind of match can't outrank a
+// better one.
+constexpr int ExactMatch       = 4000;
+constexpr int PrefixMatch      = 3000;
+constexpr int WordPrefixMatch  = 2000;
+constexpr int SubstringMatch   = 1000;
+constexpr int SubsequenceMatch = 0;
+constexpr int MaxBonus         = 400;
+
+// Matches on anything but the room name rank slightly lower.
+constexpr int SecondaryTermPenalty = 50;
+
+// Only the members of direct chats are indexed, which are named after them.
+constexpr std::size_t MaxIndexedMembers = 10;
+
+bool
+isWordStart(const QString &text, int position)
+{
+        return position == 0 || !text[position - 1].isLetterOrNumber();
+}
+}
+
+void
+RoomSearchIndex::insert(const QString &roomId, const RoomState &state)
+{
+        Entry entry;
+        entry.roomId       = roomId;
+        entry.name         = state.getName();
+        entry.deambiguator = QString::fromStdString(state.canonical_alias.content.alias);
+        entry.lastActivity = 0;
+
+        if (entry.deambiguator.isEmpty())
+                entry.deambiguator = roomId;
+
+        entry.terms << entry.name.toCaseFolded() << entry.deambiguator.toCaseFolded();
+
+        for (const auto &alias : state.aliases.content.aliases)
+                entry.terms << QString::fromStdString(alias).toCaseFolded();
+
+        const bool isDirectChat = state.name.content.name.empty() &&
+                                  state.canonical_alias.content.alias.empty() &&
+                                  state.aliases.content.aliases.empty();
+
+        if (isDirectChat && state.memberships.size() <= MaxIndexedMembers) {
+                const auto &ownId = Session::instance()->userIdentifier();
+
+                for (const auto &membership : state.memberships) {
+                        if (membership.first == ownId)
+                                continue;
+
+                        const auto displayName =
+                          QString::fromStdString(membership.second.content.display_name);
+
+                        if (!displayName.isEmpty())
+                                entry.terms << displayName.toCaseFolded();
+
+                        entry.terms << membership.first.toString().toCaseFolded();
+                }
+        }
+
+        entry.terms.removeDuplicates();
+
+        entry.characters = 0;
+        for (const auto &term : entry.terms)
+                entry.characters |= characterMask(term);
+
+        auto position = positions_.constFind(roomId);
+
+        if (position == positions_.constEnd()) {
+                positions_.insert(roomId, entries_.size());
+                entries_.push_back(std::move(entry));
+        } else {
+                auto &existing     = entries_[*position];
+                entry.lastActivity = existing.lastActivity;
+                existing           = std::move(entry);
+        }
+
+        invalidate();
+}
+
+void
+RoomSearchIndex::remove(const QString &roomId)
+{
+        auto position = positions_.find(roomId);
+
+        if (position == positions_.end())
+                return;
+
+        // The last entry takes the place of the removed one.
+        const std::size_t removed = *position;
+        positions_.erase(position);
+
+        if (removed != entries_.size() - 1) {
+                entries_[removed] = std::move(entries_.back());
+                positions_.insert(entries_[removed].roomId, removed);
+        }
+
+        entries_.pop_back();
+
+        invalidate();
+}
+
+void
+RoomSearchIndex::clear()
+{
+        entries_.clear();
+        positions_.clear();
+
+        invalidate();
+}
+
+void
+RoomSearchIndex::setLastActivity(const QString &roomId, qint64 lastActivity)
+{
+        auto position = positions_.constFind(roomId);
+
+        if (position != positions_.constEnd())
+                entries_[*position].lastActivity = lastActivity;
+}
+
+std::vector<RoomSearchResult>
+RoomSearchIndex::search(const QString &query, int limit) const
+{
+        const auto folded = query.trimmed().toCaseFolded();
+
+        if (folded.isEmpty() || limit <= 0)
+                return std::vector<RoomSearchResult>();
+
+        const auto characters = characterMask(folded);
+
+        std::vector<std::size_t> matches;
+        std::vector<std::pair<int, std::size_t>> scores;
+
+        auto match = [&](std::size_t position) {
+                const auto &entry = entries_[position];
+
+                // Skip the rooms missing any of the characters of the query.
+                if ((entry.characters & characters) != characters)
+                        return;
+
+                int best = -1;
+
+                for (int i = 0; i < entry.terms.size(); ++i) {
+                        int score = matchScore(entry.terms[i], folded);
+
+                        if (score >= 0 && i > 0)
+                                score = std::max(score - SecondaryTermPenalty, 0);
+
+                        best = std::max(best, score);
+                }
+
+                if (best >= 0) {
+                        matches.push_back(position);
+                        scores.emplace_back(best, position);
+                }
+        };
+
+        // Every room matching the query also matches any prefix of it.
+        if (!lastQuery_.isEmpty() && folded.startsWith(lastQuery_)) {
+                for (const auto position : lastMatches_)
+                        match(position);
+        } else {
+                for (std::size_t position = 0; position < entries_.size(); ++position)
+                        match(position);
+        }
+
+        lastQuery_   = folded;
+        lastMatches_ = std::move(matches);
+
+        const auto count = std::min(scores.size(), static_cast<std::size_t>(limit));
+
+        std::partial_sort(scores.begin(),
+                          scores.begin() + count,
+                          scores.end(),
+                          [this](const std::pair<int, std::size_t> &a,
+                                 const std::pair<int, std::size_t> &b) {
+                                  if (a.first != b.first)
+                                          return a.first > b.first;
+
+                                  const auto &first  = entries_[a.second];
+                                  const auto &second = entries_[b.second];
+
+                                  if (first.lastActivity != second.lastActivity)
+                                          return first.lastActivity > second.lastActivity;
+
+                                  return first.name < second.name;
+                          });
+
+        std::vector<RoomSearchResult> results;
+        results.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i) {
+                const auto &entry = entries_[scores[i].second];
+                results.push_back({entry.roomId, entry.name, entry.deambiguator});
+        }
+
+        return results;
+}
+
+quint64
+RoomSearchIndex::characterMask(const QString &text)
+{
+        quint64 mask = 0;
+
+        // Letters and digits get a bit each and every other character
+        // shares one of the remaining bits.
+        for (const auto c : text) {
+                const auto u = c.unicode();
+
+                if (u >= 'a' && u <= 'z')
+                        mask |= quint64(1) << (u - 'a');
+                else if (u >= '0' && u <= '9')
+                        mask |= quint64(1) << (26 + u - '0');
+                else
+                        mask |= quint64(1) << (36 + u % 28);
+        }
+
+        return mask;
+}
+
+int
+RoomSearchIndex::matchScore(const QString &term, const QString &query)
+{
+        // Shorter terms are closer matches.
+        const int lengthPenalty = std::min(term.size() - query.size(), MaxBonus);
+        const int position      = term.indexOf(query);
+
+        if (position == 0)
+                return term.size() == query.size() ? ExactMatch : PrefixMatch - lengthPenalty;
+
+        if (position > 0)
+                return (isWordStart(term, position) ? WordPrefixMatch : SubstringMatch) -
+                       lengthPenalty;
+
+        // The characters of the query appear in order, but not together.
+        // Runs of consecutive characters and word starts score higher.
+        int score    = 0;
+        int previous = -2;
+        int i        = 0;
+
+        for (const auto c : query) {
+                while (i < term.size() && term[i] != c)
+                        ++i;
+
+                if (i == term.size())
+                        return -1;
+
+                score += 1;
+
+                if (i == previous + 1)
+                        score += 2;
+
+                if (isWordStart(term, i))
+                        score += 3;
+
+                previous = i;
+                ++i;
+        }
+
+        return SubsequenceMatch + std::min(score, MaxBonus);
+}
+
+void
+RoomSearchIndex::invalidate()
+{
+        lastQuery_.clear();
+        lastMatches_.clear();
+}
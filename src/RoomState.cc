@@ -15,12 +15,22 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+
 #include <QDebug>
 #include <QJsonArray>
 #include <QJsonObject>
-#include <QSettings>
 
 #include "RoomState.h"
+#include "Session.h"
+
+quint64
+RoomState::nextVersion()
+{
+        // Nothing ties a state to the GUI thread.
+        static std::atomic<quint64> version(0);
+        return ++version;
+}
 
 RoomState::RoomState() {}
 RoomState::RoomState(const mtx::responses::Timeline &timeline)
@@ -29,11 +39,83 @@ RoomState::RoomState(const mtx::responses::Timeline &timeline)
 }
 RoomState::RoomState(const mtx::responses::State &state) { updateFromEvents(state.events); }
 
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Aliases> &event) const
+{
+        state.aliases = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Avatar> &event) const
+{
+        state.avatar = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(
+  const StateEvent<mtx::events::state::CanonicalAlias> &event) const
+{
+        state.canonical_alias = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Create> &event) const
+{
+        state.create = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(
+  const StateEvent<mtx::events::state::HistoryVisibility> &event) const
+{
+        state.history_visibility = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::JoinRules> &event) const
+{
+        state.join_rules = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Member> &event) const
+{
+        state.memberships.emplace(Identifier(event.state_key), event);
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Name> &event) const
+{
+        state.name = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::PowerLevels> &event) const
+{
+        state.power_levels = event;
+        return true;
+}
+
+bool
+RoomState::EventUpdater::operator()(const StateEvent<mtx::events::state::Topic> &event) const
+{
+        state.topic = event;
+        return true;
+}
+
 void
 RoomState::resolveName()
 {
         name_ = "Empty Room";
-        userAvatar_.clear();
+        userAvatar_ = Identifier();
 
         if (!name.content.name.empty()) {
                 name_ = QString::fromStdString(name.content.name).simplified();
@@ -51,28 +133,33 @@ RoomState::resolveName()
                 return;
         }
 
-        QSettings settings;
-        auto user_id = settings.value("auth/user_id");
+        const auto &user_id = Session::instance()->userIdentifier();
 
+        // The members are in no particular order, so the room is named after
+        // the joined member with the lowest user id to keep the name stable.
         // TODO: Display names should be sorted alphabetically.
-        for (const auto membership : memberships) {
-                const auto stateKey = QString::fromStdString(membership.second.state_key);
+        const RoomMembers::Member *first = nullptr;
 
-                if (stateKey == user_id)
+        for (const auto &membership : memberships) {
+                const auto &stateKey = membership.first;
+
+                if (stateKey == user_id ||
+                    membership.second.content.membership != mtx::events::state::Membership::Join)
                         continue;
 
-                if (membership.second.content.membership == mtx::events::state::Membership::Join) {
+                if (!first || stateKey < userAvatar_) {
+                        first       = &membership.second;
                         userAvatar_ = stateKey;
-                        auto displayName =
-                          QString::fromStdString(membership.second.content.display_name);
+                }
+        }
 
-                        if (displayName.isEmpty())
-                                name_ = stateKey;
-                        else
-                                name_ = displayName;
+        if (first) {
+                const auto displayName = QString::fromStdString(first->content.display_name);
 
-                        break;
-                }
+                if (displayName.isEmpty())
+                        name_ = userAvatar_.toString();
+                else
+                        name_ = displayName;
         }
 
         // TODO: pluralization
@@ -88,11 +175,12 @@ RoomState::resolveAvatar()
                 return;
         }
 
-        if (memberships.count(userAvatar_.toStdString()) != 0) {
-                avatar_ =
-                  QString::fromStdString(memberships[userAvatar_.toStdString()].content.avatar_url);
+        const auto member = memberships.find(userAvatar_);
+
+        if (member != memberships.cend()) {
+                avatar_ = QString::fromStdString(member->second.content.avatar_url);
         } else {
-                qWarning() << "Setting room avatar from unknown user id" << userAvatar_;
+                qWarning() << "Setting room avatar from unknown user id" << userAvatar_.toString();
         }
 }
 
@@ -100,13 +188,11 @@ RoomState::resolveAvatar()
 void
 RoomState::removeLeaveMemberships()
 {
-        for (auto it = memberships.cbegin(); it != memberships.cend();) {
-                if (it->second.content.membership == mtx::events::state::Membership::Leave) {
-                        it = memberships.erase(it);
-                } else {
-                        ++it;
-                }
-        }
+        version_ = nextVersion();
+
+        memberships.removeIf([](const RoomMembers::Member &member) {
+                return member.content.membership == mtx::events::state::Membership::Leave;
+        });
 }
 
 void
@@ -115,6 +201,8 @@ RoomState::update(const RoomState &state)
         bool needsNameCalculation   = false;
         bool needsAvatarCalculation = false;
 
+        version_ = nextVersion();
+
         if (aliases.event_id != state.aliases.event_id)
                 aliases = state.aliases;
 
@@ -151,13 +239,13 @@ RoomState::update(const RoomState &state)
         for (auto it = state.memberships.cbegin(); it != state.memberships.cend(); ++it) {
                 auto membershipState = it->second.content.membership;
 
-                if (it->first == userAvatar_.toStdString()) {
+                if (it->first == userAvatar_) {
                         needsNameCalculation   = true;
                         needsAvatarCalculation = true;
                 }
 
                 if (membershipState == mtx::events::state::Membership::Leave)
-                        this->memberships.erase(this->memberships.find(it->first));
+                        this->memberships.erase(it->first);
                 else
                         this->memberships.emplace(it->first, it->second);
         }
@@ -207,6 +295,8 @@ RoomState::serialize() const
 void
 RoomState::parse(const nlohmann::json &object)
 {
+        version_ = nextVersion();
+
         if (object.count("aliases") != 0) {
                 try {
                         aliases = object.at("aliases")
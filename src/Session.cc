@@ -0,0 +1,122 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QSettings>
+
+#include "Session.h"
+
+// Number of transaction ids that are reserved with a single write.
+static constexpr int TXN_ID_BLOCK = 100;
+
+Session *
+Session::instance()
+{
+        static Session *session = new Session;
+        return session;
+}
+
+Session::Session(QObject *parent)
+  : QObject(parent)
+{
+        if (QCoreApplication::instance())
+                connect(qApp, &QCoreApplication::aboutToQuit, this, &Session::flush);
+
+        load();
+}
+
+void
+Session::load()
+{
+        QSettings settings;
+
+        userId_      = Identifier(settings.value("auth/user_id").toString());
+        homeServer_  = settings.value("auth/home_server").toString();
+        accessToken_ = settings.value("auth/access_token").toString();
+        txnId_       = settings.value("client/transaction_id", 1).toInt();
+
+        reservedTxnId_ = txnId_;
+}
+
+void
+Session::setLogin(const QString &user_id,
+                  const QString &home_server,
+                  const QString &access_token)
+{
+        userId_      = Identifier(user_id);
+        homeServer_  = home_server;
+        accessToken_ = access_token;
+
+        // The credentials are needed to restore the session, so they are
+        // written immediately.
+        isDirty_ = true;
+        flush();
+}
+
+int
+Session::nextTransactionId()
+{
+        txnId_ += 1;
+
+        // The exact id is written on quit, so a restart doesn't skip the rest
+        // of the block.
+        isDirty_ = true;
+
+        if (txnId_ > reservedTxnId_ && hasActiveUser()) {
+                reservedTxnId_ = txnId_ + TXN_ID_BLOCK - 1;
+
+                QSettings settings;
+                settings.setValue("client/transaction_id", reservedTxnId_);
+        }
+
+        return txnId_;
+}
+
+void
+Session::clear()
+{
+        isDirty_ = false;
+
+        userId_ = Identifier();
+        homeServer_.clear();
+        accessToken_.clear();
+        txnId_         = 1;
+        reservedTxnId_ = 1;
+}
+
+bool
+Session::hasActiveUser() const
+{
+        return !userId_.isEmpty() && !homeServer_.isEmpty() && !accessToken_.isEmpty();
+}
+
+void
+Session::flush()
+{
+        // Nothing to store after a logout.
+        if (!isDirty_ || !hasActiveUser())
+                return;
+
+        QSettings settings;
+        settings.setValue("auth/access_token", accessToken_);
+        settings.setValue("auth/home_server", homeServer_);
+        settings.setValue("auth/user_id", userId());
+        settings.setValue("client/transaction_id", txnId_);
+
+        reservedTxnId_ = txnId_;
+        isDirty_       = false;
+}
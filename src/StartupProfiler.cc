@@ -0,0 +1,193 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+#include <QWidget>
+
+#include "StartupProfiler.h"
+
+StartupProfiler::Mode StartupProfiler::mode_ = StartupProfiler::Mode::Disabled;
+bool StartupProfiler::isFinished_            = false;
+int StartupProfiler::depth_                  = 0;
+QElapsedTimer StartupProfiler::clock_;
+QList<StartupProfiler::Record> StartupProfiler::records_;
+
+StartupProfiler::StartupProfiler(QObject *parent)
+  : QObject(parent)
+{}
+
+void
+StartupProfiler::init(int argc, char *argv[])
+{
+        for (int i = 1; i < argc; ++i) {
+                if (std::strcmp(argv[i], "--profile-startup") == 0)
+                        mode_ = Mode::Report;
+                else if (std::strcmp(argv[i], "--benchmark-startup") == 0)
+                        mode_ = Mode::Benchmark;
+        }
+
+        if (isEnabled())
+                clock_.start();
+}
+
+void
+StartupProfiler::beginPhase(const QString &name)
+{
+        if (!isEnabled() || isFinished_)
+                return;
+
+        Record record;
+        record.name  = name;
+        record.start = clock_.nsecsElapsed();
+        record.depth = depth_++;
+
+        records_.append(record);
+}
+
+void
+StartupProfiler::endPhase(const QString &name)
+{
+        if (!isEnabled() || isFinished_)
+                return;
+
+        // Close the innermost open phase with that name.
+        for (int i = records_.size() - 1; i >= 0; --i) {
+                auto &record = records_[i];
+
+                if (record.name == name && record.end == -1 && record.start != -1) {
+                        record.end = clock_.nsecsElapsed();
+                        depth_     = record.depth;
+                        return;
+                }
+        }
+
+        qWarning() << "StartupProfiler: ending unknown phase" << name;
+}
+
+void
+StartupProfiler::mark(const QString &name)
+{
+        if (!isEnabled() || isFinished_)
+                return;
+
+        Record record;
+        record.name  = name;
+        record.start = clock_.nsecsElapsed();
+        record.end   = record.start;
+        record.depth = depth_;
+
+        records_.append(record);
+}
+
+void
+StartupProfiler::finishOnPaint(QWidget *widget)
+{
+        if (!isEnabled() || isFinished_ || widget == nullptr)
+                return;
+
+        widget->installEventFilter(new StartupProfiler(widget));
+        widget->update();
+}
+
+bool
+StartupProfiler::eventFilter(QObject *obj, QEvent *event)
+{
+        if (event->type() == QEvent::Paint) {
+                obj->removeEventFilter(this);
+                deleteLater();
+
+                // Let the paint event be processed before taking the timestamp.
+                QTimer::singleShot(0, []() {
+                        mark("First paint");
+                        finish();
+                });
+        }
+
+        return QObject::eventFilter(obj, event);
+}
+
+void
+StartupProfiler::finish()
+{
+        if (isFinished_)
+                return;
+
+        // Close the phases that are still open, e.g the event loop.
+        const auto now = clock_.nsecsElapsed();
+        for (auto &record : records_) {
+                if (record.end == -1)
+                        record.end = now;
+        }
+
+        isFinished_ = true;
+
+        if (mode_ == Mode::Benchmark) {
+                printJson();
+                QCoreApplication::exit(0);
+        } else {
+                printReport();
+        }
+}
+
+void
+StartupProfiler::printReport()
+{
+        qInfo() << "Startup phases (ms):";
+
+        for (const auto &record : records_) {
+                const auto indent = QString(record.depth * 2, ' ');
+                const auto start  = record.start / 1000000.0;
+                const auto length = (record.end - record.start) / 1000000.0;
+
+                qInfo().noquote() << QString("%1%2 @ %3 +%4")
+                                       .arg(indent)
+                                       .arg(record.name)
+                                       .arg(start, 0, 'f', 2)
+                                       .arg(length, 0, 'f', 2);
+        }
+}
+
+void
+StartupProfiler::printJson()
+{
+        QJsonArray phases;
+
+        for (const auto &record : records_) {
+                QJsonObject phase;
+                phase["name"]        = record.name;
+                phase["depth"]       = record.depth;
+                phase["start_ms"]    = record.start / 1000000.0;
+                phase["duration_ms"] = (record.end - record.start) / 1000000.0;
+
+                phases.append(phase);
+        }
+
+        QJsonObject report;
+        report["phases"] = phases;
+
+        QTextStream out(stdout);
+        out << QJsonDocument(report).toJson();
+}
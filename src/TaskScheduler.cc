@@ -0,0 +1,127 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+
+#include "StartupProfiler.h"
+#include "TaskScheduler.h"
+
+TaskScheduler *
+TaskScheduler::instance()
+{
+        static TaskScheduler *scheduler = new TaskScheduler;
+        return scheduler;
+}
+
+TaskScheduler::TaskScheduler(QObject *parent)
+  : QObject(parent)
+{
+        // A zero interval timer fires once per event loop iteration after the
+        // pending events have been processed.
+        timer_ = new QTimer(this);
+        timer_->setInterval(0);
+
+        connect(timer_, &QTimer::timeout, this, &TaskScheduler::runSlice);
+}
+
+void
+TaskScheduler::schedule(QObject *owner, Chunk chunk)
+{
+        Job job;
+        job.owner = owner;
+        job.chunk = std::move(chunk);
+
+        queue_.push_back(std::move(job));
+
+        if (!timer_->isActive())
+                timer_->start();
+}
+
+void
+TaskScheduler::cancel(QObject *owner)
+{
+        queue_.erase(std::remove_if(queue_.begin(),
+                                    queue_.end(),
+                                    [owner](const Job &job) { return job.owner == owner; }),
+                     queue_.end());
+
+        if (runningOwner_ == owner)
+                isRunningCancelled_ = true;
+}
+
+bool
+TaskScheduler::isIdle() const
+{
+        return queue_.empty();
+}
+
+void
+TaskScheduler::runSlice()
+{
+        QElapsedTimer slice;
+        slice.start();
+
+        while (slice.elapsed() < SliceBudget && hasNextJob()) {
+                // The job is taken out of the queue while it runs, so it can
+                // safely schedule or cancel other jobs.
+                auto job = std::move(queue_.front());
+                queue_.pop_front();
+
+                runningOwner_       = job.owner.data();
+                isRunningCancelled_ = false;
+
+                const bool hasMoreWork = job.chunk();
+
+                runningOwner_ = nullptr;
+
+                if (hasMoreWork && !isRunningCancelled_ && !job.owner.isNull())
+                        queue_.push_front(std::move(job));
+        }
+
+        const auto elapsed = slice.elapsed();
+
+        totalSlices_ += 1;
+        longestSlice_ = std::max(longestSlice_, elapsed);
+
+        if (elapsed > SliceBudget)
+                overBudgetSlices_ += 1;
+
+        if (isIdle()) {
+                timer_->stop();
+
+                // The statistics are part of the startup profile, since most
+                // of the scheduled work is the initial sync.
+                if (StartupProfiler::isEnabled()) {
+                        StartupProfiler::mark(QString("Scheduler idle (%1 slices, %2 over budget, "
+                                                      "longest %3 ms)")
+                                                .arg(totalSlices_)
+                                                .arg(overBudgetSlices_)
+                                                .arg(longestSlice_));
+                }
+        }
+}
+
+bool
+TaskScheduler::hasNextJob()
+{
+        while (!queue_.empty() && queue_.front().owner.isNull())
+                queue_.pop_front();
+
+        return !queue_.empty();
+}
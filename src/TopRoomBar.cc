@@ -26,6 +26,7 @@
 #include "OverlayModal.h"
 #include "RoomSettings.h"
 #include "TopRoomBar.h"
+#include "Utils.h"
 
 TopRoomBar::TopRoomBar(QWidget *parent)
   : QWidget(parent)
@@ -187,8 +188,7 @@ TopRoomBar::paintEvent(QPaintEvent *event)
                 elidedText =
                   QFontMetrics(topicLabel_->font())
                     .elidedText(roomTopic_, Qt::ElideRight, topicLabel_->width() - perFrameResize);
-        elidedText.replace(URL_REGEX, URL_HTML);
-        topicLabel_->setText(elidedText);
+        topicLabel_->setText(utils::linkifyMessage(elidedText));
 }
 
 void
@@ -44,7 +44,7 @@ UserInfoWidget::UserInfoWidget(QWidget *parent)
         userAvatar_ = new Avatar(this);
         userAvatar_->setObjectName("userAvatar");
         userAvatar_->setLetter(QChar('?'));
-        userAvatar_->setSize(55);
+        userAvatar_->setSize(conf::userInfoWidget::avatarSize);
 
         QFont nameFont("Open Sans SemiBold");
         nameFont.setPixelSize(conf::userInfoWidget::fonts::displayName);
@@ -0,0 +1,358 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+#include <QUrlQuery>
+
+#include "Utils.h"
+
+namespace {
+// The thumbnail sizes generated by default from the reference homeserver.
+// Any other size causes the server to either generate a new thumbnail or
+// return the nearest one, so we only ever ask for these.
+const QSize CROP_SIZES[]  = {QSize(32, 32), QSize(96, 96)};
+const QSize SCALE_SIZES[] = {QSize(320, 240), QSize(640, 480), QSize(800, 600)};
+
+const QString MXC_PREFIX = "mxc://";
+
+const QString MATRIX_TO_PREFIX = "https://matrix.to/#/";
+const QString MAILTO_PREFIX    = "mailto:";
+
+const char *const URL_SCHEMES[] = {"http://", "https://", "ftp://"};
+
+enum class TokenType
+{
+        Text,
+        Url,
+        Email,
+        MatrixId,
+};
+
+bool
+isSpace(QChar c)
+{
+        return c.isSpace();
+}
+
+bool
+isLeadingPunctuation(QChar c)
+{
+        return c == '(' || c == '[' || c == '<' || c == '"' || c == '\'';
+}
+
+bool
+isTrailingPunctuation(QChar c)
+{
+        switch (c.unicode()) {
+        case '.':
+        case ',':
+        case ';':
+        case ':':
+        case '!':
+        case '?':
+        case ')':
+        case ']':
+        case '>':
+        case '"':
+        case '\'':
+                return true;
+        default:
+                return false;
+        }
+}
+
+bool
+isAsciiAlnum(QChar c)
+{
+        const auto u = c.unicode();
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9');
+}
+
+// Hostnames, with an optional port.
+bool
+isServerName(const QChar *begin, const QChar *end)
+{
+        if (begin == end)
+                return false;
+
+        for (auto it = begin; it != end; ++it) {
+                if (!isAsciiAlnum(*it) && *it != '.' && *it != '-' && *it != ':')
+                        return false;
+        }
+
+        return true;
+}
+
+bool
+isUrl(const QChar *begin, const QChar *end)
+{
+        for (const auto scheme : URL_SCHEMES) {
+                const auto length = static_cast<int>(qstrlen(scheme));
+
+                if (end - begin <= length)
+                        continue;
+
+                int i = 0;
+                while (i < length && begin[i].toLower() == QLatin1Char(scheme[i]))
+                        ++i;
+
+                if (i == length)
+                        return true;
+        }
+
+        return false;
+}
+
+// @localpart:server or #alias:server
+bool
+isMatrixId(const QChar *begin, const QChar *end)
+{
+        if (end - begin < 4 || (*begin != '@' && *begin != '#'))
+                return false;
+
+        auto separator = std::find(begin + 1, end, QChar(':'));
+
+        return separator != begin + 1 && separator != end && isServerName(separator + 1, end);
+}
+
+bool
+isEmail(const QChar *begin, const QChar *end)
+{
+        auto at = std::find(begin, end, QChar('@'));
+
+        if (at == begin || at == end)
+                return false;
+
+        for (auto it = begin; it != at; ++it) {
+                if (!isAsciiAlnum(*it) && *it != '.' && *it != '_' && *it != '%' &&
+                    *it != '+' && *it != '-')
+                        return false;
+        }
+
+        // The domain needs at least one inner dot.
+        auto dot = std::find(at + 1, end, QChar('.'));
+
+        return dot != at + 1 && dot != end && dot + 1 != end && *(end - 1) != '.' &&
+               isServerName(at + 1, end) && std::find(at + 1, end, QChar(':')) == end;
+}
+
+TokenType
+classify(const QChar *begin, const QChar *end)
+{
+        if (isUrl(begin, end))
+                return TokenType::Url;
+
+        if (isMatrixId(begin, end))
+                return TokenType::MatrixId;
+
+        if (isEmail(begin, end))
+                return TokenType::Email;
+
+        return TokenType::Text;
+}
+
+void
+appendEscaped(QString &out, const QChar *begin, const QChar *end)
+{
+        for (auto it = begin; it != end; ++it) {
+                switch (it->unicode()) {
+                case '<':
+                        out.append(QLatin1String("&lt;"));
+                        break;
+                case '>':
+                        out.append(QLatin1String("&gt;"));
+                        break;
+                case '&':
+                        out.append(QLatin1String("&amp;"));
+                        break;
+                case '"':
+                        out.append(QLatin1String("&quot;"));
+                        break;
+                case '\n':
+                        out.append(QLatin1String("<br/>"));
+                        break;
+                default:
+                        out.append(*it);
+                }
+        }
+}
+
+void
+appendLink(QString &out, const QString &prefix, const QChar *begin, const QChar *end)
+{
+        out.append(QLatin1String("<a href=\""));
+        out.append(prefix);
+        appendEscaped(out, begin, end);
+        out.append(QLatin1String("\">"));
+        appendEscaped(out, begin, end);
+        out.append(QLatin1String("</a>"));
+}
+}
+
+QSize
+utils::thumbnailSize(const QSize &size, qreal devicePixelRatio, ThumbnailMethod method)
+{
+        const QSize target = size * devicePixelRatio;
+
+        if (method == ThumbnailMethod::Crop) {
+                for (const auto &candidate : CROP_SIZES) {
+                        if (candidate.width() >= target.width() &&
+                            candidate.height() >= target.height())
+                                return candidate;
+                }
+
+                // Larger crops have to stay square too, or the server would
+                // crop the image to the 4:3 ratio of the scaled sizes.
+                const int side = std::max(target.width(), target.height());
+
+                for (const auto &candidate : SCALE_SIZES) {
+                        if (candidate.width() >= side)
+                                return QSize(candidate.width(), candidate.width());
+                }
+
+                const auto &largest = SCALE_SIZES[sizeof(SCALE_SIZES) / sizeof(SCALE_SIZES[0]) - 1];
+                return QSize(largest.width(), largest.width());
+        }
+
+        // Scaled thumbnails keep the aspect ratio of the original, so the
+        // candidate has to cover the requested box in both dimensions.
+        for (const auto &candidate : SCALE_SIZES) {
+                if (candidate.width() >= target.width() && candidate.height() >= target.height())
+                        return candidate;
+        }
+
+        return SCALE_SIZES[sizeof(SCALE_SIZES) / sizeof(SCALE_SIZES[0]) - 1];
+}
+
+QUrl
+utils::mediaDownloadUrl(const QUrl &server, const QString &mxcUrl)
+{
+        if (!mxcUrl.startsWith(MXC_PREFIX))
+                return QUrl();
+
+        return QUrl(QString("%1/_matrix/media/r0/download/%2")
+                      .arg(server.toString(), mxcUrl.mid(MXC_PREFIX.size())));
+}
+
+QUrl
+utils::mediaThumbnailUrl(const QUrl &server,
+                         const QString &mxcUrl,
+                         const QSize &size,
+                         ThumbnailMethod method)
+{
+        if (!mxcUrl.startsWith(MXC_PREFIX))
+                return QUrl();
+
+        QUrlQuery query;
+        query.addQueryItem("width", QString::number(size.width()));
+        query.addQueryItem("height", QString::number(size.height()));
+        query.addQueryItem("method", method == ThumbnailMethod::Crop ? "crop" : "scale");
+
+        QUrl endpoint(QString("%1/_matrix/media/r0/thumbnail/%2")
+                        .arg(server.toString(), mxcUrl.mid(MXC_PREFIX.size())));
+        endpoint.setQuery(query);
+
+        return endpoint;
+}
+
+QString
+utils::linkifyMessage(const QString &text)
+{
+        const QChar *begin = text.constData();
+        const QChar *end   = begin + text.size();
+
+        QString formatted;
+        formatted.reserve(text.size() + text.size() / 4);
+
+        auto it = begin;
+
+        while (it != end) {
+                // Whitespace is copied as is, apart from newlines.
+                if (isSpace(*it)) {
+                        appendEscaped(formatted, it, it + 1);
+                        ++it;
+                        continue;
+                }
+
+                // Every token is scanned once to find its end and classify
+                // it, and once more to write it, so the cost stays linear.
+                auto tokenEnd = std::find_if(it, end, isSpace);
+
+                // Punctuation around links isn't part of them, e.g (@a:b.c).
+                // A closing parenthesis is kept if the link has an opening
+                // one, e.g https://en.wikipedia.org/wiki/Bar_(band).
+                const bool hasParenthesis = std::find(it, tokenEnd, QChar('(')) != tokenEnd;
+
+                auto first = it;
+                while (first != tokenEnd && isLeadingPunctuation(*first))
+                        ++first;
+
+                auto last = tokenEnd;
+                while (last != first && isTrailingPunctuation(*(last - 1)) &&
+                       !(*(last - 1) == ')' && hasParenthesis && *it != '('))
+                        --last;
+
+                const auto type = first != last ? classify(first, last) : TokenType::Text;
+
+                if (type == TokenType::Text) {
+                        appendEscaped(formatted, it, tokenEnd);
+                } else {
+                        appendEscaped(formatted, it, first);
+
+                        if (type == TokenType::Url)
+                                appendLink(formatted, QString(), first, last);
+                        else if (type == TokenType::Email)
+                                appendLink(formatted, MAILTO_PREFIX, first, last);
+                        else
+                                appendLink(formatted, MATRIX_TO_PREFIX, first, last);
+
+                        appendEscaped(formatted, last, tokenEnd);
+                }
+
+                it = tokenEnd;
+        }
+
+        return formatted;
+}
+
+QImage
+utils::decodeImage(const QByteArray &data, const QSize &maxSize)
+{
+        QBuffer buffer;
+        buffer.setData(data);
+
+        QImageReader reader(&buffer);
+
+        // Not every format reports its size before decoding, in which case
+        // the image is decoded at its original size.
+        const auto size = reader.size();
+
+        if (size.isValid() && (size.width() > maxSize.width() || size.height() > maxSize.height()))
+                reader.setScaledSize(
+                  size.scaled(maxSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+
+        QImage img;
+
+        if (!reader.read(&img))
+                qWarning() << "Failed to decode image:" << reader.errorString();
+
+        return img;
+}
@@ -19,13 +19,36 @@
 #include <QDesktopWidget>
 #include <QPainter>
 
+#include "ImageCache.h"
+
 #include "dialogs/ImageOverlay.h"
 
 using namespace dialogs;
 
-ImageOverlay::ImageOverlay(QPixmap image, QWidget *parent)
+namespace {
+// Left and right margins as a fraction of the screen width.
+constexpr double OuterMargin = 0.12;
+
+// The area available to the image on the screen.
+QSize
+imageArea(const QRect &screen)
+{
+        const int outer_margin = screen.width() * OuterMargin;
+
+        return QSize(screen.width() - 2 * outer_margin, screen.height());
+}
+}
+
+QPixmap
+ImageOverlay::cachedImage(const QString &mediaId)
+{
+        const auto screen = QApplication::desktop()->availableGeometry();
+
+        return ImageCache::find(mediaId, imageArea(screen), qApp->devicePixelRatio());
+}
+
+ImageOverlay::ImageOverlay(QPixmap image, const QString &mediaId, QWidget *parent)
   : QWidget{parent}
-  , originalImage_{image}
 {
         setMouseTracking(true);
         setParent(0);
@@ -42,38 +65,15 @@ ImageOverlay::ImageOverlay(QPixmap image, QWidget *parent)
         move(QApplication::desktop()->mapToGlobal(screen_.topLeft()));
         resize(screen_.size());
 
+        // The screen doesn't change while the overlay is open, so the image
+        // is only scaled once.
+        image_ = ImageCache::fitted(mediaId, image, imageArea(screen_), qApp->devicePixelRatio());
+
         connect(this, SIGNAL(closing()), this, SLOT(close()));
 
         raise();
 }
 
-// TODO: Move this into Utils
-void
-ImageOverlay::scaleImage(int max_width, int max_height)
-{
-        if (originalImage_.isNull())
-                return;
-
-        auto width_ratio  = (double)max_width / (double)originalImage_.width();
-        auto height_ratio = (double)max_height / (double)originalImage_.height();
-
-        auto min_aspect_ratio = std::min(width_ratio, height_ratio);
-
-        int final_width  = 0;
-        int final_height = 0;
-
-        if (min_aspect_ratio > 1) {
-                final_width  = originalImage_.width();
-                final_height = originalImage_.height();
-        } else {
-                final_width  = originalImage_.width() * min_aspect_ratio;
-                final_height = originalImage_.height() * min_aspect_ratio;
-        }
-
-        image_ = originalImage_.scaled(
-          final_width, final_height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-}
-
 void
 ImageOverlay::paintEvent(QPaintEvent *event)
 {
@@ -86,19 +86,17 @@ ImageOverlay::paintEvent(QPaintEvent *event)
         painter.fillRect(QRect(0, 0, screen_.width(), screen_.height()), QColor(55, 55, 55, 170));
 
         // Left and Right margins
-        int outer_margin = screen_.width() * 0.12;
+        int outer_margin = screen_.width() * OuterMargin;
         int buttonSize   = 36;
         int margin       = outer_margin * 0.1;
 
-        int max_width  = screen_.width() - 2 * outer_margin;
-        int max_height = screen_.height();
-
-        scaleImage(max_width, max_height);
+        const auto area      = imageArea(screen_);
+        const auto imageSize = image_.size() / image_.devicePixelRatio();
 
-        int diff_x = max_width - image_.width();
-        int diff_y = max_height - image_.height();
+        int diff_x = area.width() - imageSize.width();
+        int diff_y = area.height() - imageSize.height();
 
-        content_ = QRect(outer_margin + diff_x / 2, diff_y / 2, image_.width(), image_.height());
+        content_ = QRect(QPoint(outer_margin + diff_x / 2, diff_y / 2), imageSize);
         close_button_ =
           QRect(screen_.width() - margin - buttonSize, margin, buttonSize, buttonSize);
 
@@ -0,0 +1,365 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include "Config.h"
+#include "emoji/Segmenter.h"
+
+namespace {
+struct EmojiRange
+{
+        uint first;
+        uint last;
+};
+
+// Generated by scripts/emoji_codegen.py --ranges resources/emoji.json
+const EmojiRange EMOJI_RANGES[] = {
+  {0xa9, 0xa9},
+  {0xae, 0xae},
+  {0x203c, 0x203c},
+  {0x2049, 0x2049},
+  {0x2122, 0x2122},
+  {0x2139, 0x2139},
+  {0x2194, 0x2199},
+  {0x21a9, 0x21aa},
+  {0x231a, 0x231b},
+  {0x2328, 0x2328},
+  {0x23cf, 0x23cf},
+  {0x23e9, 0x23f3},
+  {0x23f8, 0x23fa},
+  {0x24c2, 0x24c2},
+  {0x25aa, 0x25ab},
+  {0x25b6, 0x25b6},
+  {0x25c0, 0x25c0},
+  {0x25fb, 0x25fe},
+  {0x2600, 0x2604},
+  {0x260e, 0x260e},
+  {0x2611, 0x2611},
+  {0x2614, 0x2615},
+  {0x2618, 0x2618},
+  {0x261d, 0x261d},
+  {0x2620, 0x2620},
+  {0x2622, 0x2623},
+  {0x2626, 0x2626},
+  {0x262a, 0x262a},
+  {0x262e, 0x262f},
+  {0x2638, 0x263a},
+  {0x2648, 0x2653},
+  {0x2660, 0x2660},
+  {0x2663, 0x2663},
+  {0x2665, 0x2666},
+  {0x2668, 0x2668},
+  {0x267b, 0x267b},
+  {0x267f, 0x267f},
+  {0x2692, 0x2694},
+  {0x2696, 0x2697},
+  {0x2699, 0x2699},
+  {0x269b, 0x269c},
+  {0x26a0, 0x26a1},
+  {0x26aa, 0x26ab},
+  {0x26b0, 0x26b1},
+  {0x26bd, 0x26be},
+  {0x26c4, 0x26c5},
+  {0x26c8, 0x26c8},
+  {0x26ce, 0x26cf},
+  {0x26d1, 0x26d1},
+  {0x26d3, 0x26d4},
+  {0x26e9, 0x26ea},
+  {0x26f0, 0x26f5},
+  {0x26f7, 0x26fa},
+  {0x26fd, 0x26fd},
+  {0x2702, 0x2702},
+  {0x2705, 0x2705},
+  {0x2708, 0x270d},
+  {0x270f, 0x270f},
+  {0x2712, 0x2712},
+  {0x2714, 0x2714},
+  {0x2716, 0x2716},
+  {0x271d, 0x271d},
+  {0x2721, 0x2721},
+  {0x2728, 0x2728},
+  {0x2733, 0x2734},
+  {0x2744, 0x2744},
+  {0x2747, 0x2747},
+  {0x274c, 0x274c},
+  {0x274e, 0x274e},
+  {0x2753, 0x2755},
+  {0x2757, 0x2757},
+  {0x2763, 0x2764},
+  {0x2795, 0x2797},
+  {0x27a1, 0x27a1},
+  {0x27b0, 0x27b0},
+  {0x27bf, 0x27bf},
+  {0x2934, 0x2935},
+  {0x2b05, 0x2b07},
+  {0x2b1b, 0x2b1c},
+  {0x2b50, 0x2b50},
+  {0x2b55, 0x2b55},
+  {0x3030, 0x3030},
+  {0x303d, 0x303d},
+  {0x3297, 0x3297},
+  {0x3299, 0x3299},
+  {0x1f004, 0x1f004},
+  {0x1f0cf, 0x1f0cf},
+  {0x1f170, 0x1f171},
+  {0x1f17e, 0x1f17f},
+  {0x1f18e, 0x1f18e},
+  {0x1f191, 0x1f19a},
+  {0x1f1e6, 0x1f1ff},
+  {0x1f201, 0x1f202},
+  {0x1f21a, 0x1f21a},
+  {0x1f22f, 0x1f22f},
+  {0x1f232, 0x1f23a},
+  {0x1f250, 0x1f251},
+  {0x1f300, 0x1f321},
+  {0x1f324, 0x1f393},
+  {0x1f396, 0x1f397},
+  {0x1f399, 0x1f39b},
+  {0x1f39e, 0x1f3f0},
+  {0x1f3f3, 0x1f3f5},
+  {0x1f3f7, 0x1f3fa},
+  {0x1f400, 0x1f4fd},
+  {0x1f4ff, 0x1f53d},
+  {0x1f549, 0x1f54e},
+  {0x1f550, 0x1f567},
+  {0x1f56f, 0x1f570},
+  {0x1f573, 0x1f57a},
+  {0x1f587, 0x1f587},
+  {0x1f58a, 0x1f58d},
+  {0x1f590, 0x1f590},
+  {0x1f595, 0x1f596},
+  {0x1f5a4, 0x1f5a5},
+  {0x1f5a8, 0x1f5a8},
+  {0x1f5b1, 0x1f5b2},
+  {0x1f5bc, 0x1f5bc},
+  {0x1f5c2, 0x1f5c4},
+  {0x1f5d1, 0x1f5d3},
+  {0x1f5dc, 0x1f5de},
+  {0x1f5e1, 0x1f5e1},
+  {0x1f5e3, 0x1f5e3},
+  {0x1f5e8, 0x1f5e8},
+  {0x1f5ef, 0x1f5ef},
+  {0x1f5f3, 0x1f5f3},
+  {0x1f5fa, 0x1f64f},
+  {0x1f680, 0x1f6c5},
+  {0x1f6cb, 0x1f6d2},
+  {0x1f6e0, 0x1f6e5},
+  {0x1f6e9, 0x1f6e9},
+  {0x1f6eb, 0x1f6ec},
+  {0x1f6f0, 0x1f6f0},
+  {0x1f6f3, 0x1f6f6},
+  {0x1f910, 0x1f91e},
+  {0x1f920, 0x1f927},
+  {0x1f930, 0x1f930},
+  {0x1f933, 0x1f93a},
+  {0x1f93c, 0x1f93e},
+  {0x1f940, 0x1f945},
+  {0x1f947, 0x1f94b},
+  {0x1f950, 0x1f95e},
+  {0x1f980, 0x1f991},
+  {0x1f9c0, 0x1f9c0},
+};
+
+constexpr uint ZeroWidthJoiner = 0x200d;
+constexpr uint TextSelector    = 0xfe0e;
+constexpr uint EmojiSelector   = 0xfe0f;
+constexpr uint Keycap          = 0x20e3;
+
+// Symbols before the Miscellaneous Technical block (©, ™, arrows etc) are
+// displayed as text unless they are followed by the emoji selector.
+constexpr uint TextStyleLimit = 0x2300;
+
+bool
+isModifier(uint codepoint)
+{
+        return codepoint == TextSelector || codepoint == EmojiSelector || codepoint == Keycap ||
+               (codepoint >= 0x1f3fb && codepoint <= 0x1f3ff) || // Skin tones.
+               (codepoint >= 0xe0020 && codepoint <= 0xe007f);   // Subdivision flag tags.
+}
+
+bool
+isRegionalIndicator(uint codepoint)
+{
+        return codepoint >= 0x1f1e6 && codepoint <= 0x1f1ff;
+}
+
+bool
+isKeycapBase(uint codepoint)
+{
+        return (codepoint >= '0' && codepoint <= '9') || codepoint == '#' || codepoint == '*';
+}
+
+// Decode the codepoint at `pos` and store its length in code units. Past the
+// end of the text 0 is returned.
+uint
+codepointAt(const QChar *text, int size, int pos, int *length)
+{
+        if (pos >= size) {
+                *length = 0;
+                return 0;
+        }
+
+        const ushort unit = text[pos].unicode();
+
+        if (QChar::isHighSurrogate(unit) && pos + 1 < size &&
+            QChar::isLowSurrogate(text[pos + 1].unicode())) {
+                *length = 2;
+                return QChar::surrogateToUcs4(unit, text[pos + 1].unicode());
+        }
+
+        *length = 1;
+        return unit;
+}
+
+int
+sequenceLength(const QChar *text, int size, int pos)
+{
+        int length     = 0;
+        int nextLength = 0;
+
+        const uint first = codepointAt(text, size, pos, &length);
+
+        int end   = pos + length;
+        uint next = codepointAt(text, size, end, &nextLength);
+
+        if (first < 0x80) {
+                if (!isKeycapBase(first))
+                        return 0;
+
+                if (next == EmojiSelector) {
+                        end += nextLength;
+                        next = codepointAt(text, size, end, &nextLength);
+                }
+
+                return next == Keycap ? end + nextLength - pos : 0;
+        }
+
+        if (!emoji::isEmoji(first) || (first < TextStyleLimit && next != EmojiSelector))
+                return 0;
+
+        // Flags are pairs of regional indicators.
+        if (isRegionalIndicator(first)) {
+                if (isRegionalIndicator(next))
+                        end += nextLength;
+
+                return end - pos;
+        }
+
+        while (true) {
+                while (isModifier(next)) {
+                        end += nextLength;
+                        next = codepointAt(text, size, end, &nextLength);
+                }
+
+                if (next != ZeroWidthJoiner)
+                        break;
+
+                int joinedLength  = 0;
+                const uint joined = codepointAt(text, size, end + nextLength, &joinedLength);
+
+                if (!emoji::isEmoji(joined))
+                        break;
+
+                end += nextLength + joinedLength;
+                next = codepointAt(text, size, end, &nextLength);
+        }
+
+        return end - pos;
+}
+}
+
+bool
+emoji::isEmoji(uint codepoint)
+{
+        const auto range = std::upper_bound(
+          std::begin(EMOJI_RANGES),
+          std::end(EMOJI_RANGES),
+          codepoint,
+          [](uint value, const EmojiRange &range) { return value < range.first; });
+
+        return range != std::begin(EMOJI_RANGES) && codepoint <= std::prev(range)->last;
+}
+
+int
+emoji::sequenceLength(const QString &text, int pos)
+{
+        return ::sequenceLength(text.constData(), text.size(), pos);
+}
+
+QString
+emoji::formatHtml(const QString &html)
+{
+        static const QString openTag =
+          QString("<span style=\"font-family: Emoji One; font-size: %1px\">").arg(conf::emojiSize);
+        static const QString closeTag = "</span>";
+
+        const QChar *text = html.constData();
+        const int size    = html.size();
+
+        QString formatted;
+        formatted.reserve(size + size / 2);
+
+        // Start of the text that hasn't been copied yet. Plain text is copied
+        // in runs, right before an emoji or at the end.
+        int plainStart = 0;
+        int pos        = 0;
+
+        while (pos < size) {
+                const ushort unit = text[pos].unicode();
+
+                // Emoji in attributes would break the markup.
+                if (unit == '<') {
+                        while (pos < size && text[pos] != '>')
+                                ++pos;
+
+                        ++pos;
+                        continue;
+                }
+
+                // Fast path for ASCII and the other text before the emoji
+                // blocks, which can only be emoji if a selector follows.
+                if (unit < TextStyleLimit) {
+                        const ushort next = pos + 1 < size ? text[pos + 1].unicode() : 0;
+
+                        if (next != EmojiSelector && next != Keycap) {
+                                ++pos;
+                                continue;
+                        }
+                }
+
+                const int length = ::sequenceLength(text, size, pos);
+
+                if (length == 0) {
+                        pos += QChar::isHighSurrogate(unit) ? 2 : 1;
+                        continue;
+                }
+
+                formatted.append(text + plainStart, pos - plainStart);
+                formatted.append(openTag);
+                formatted.append(text + pos, length);
+                formatted.append(closeTag);
+
+                pos += length;
+                plainStart = pos;
+        }
+
+        formatted.append(text + plainStart, std::min(pos, size) - plainStart);
+
+        return formatted;
+}
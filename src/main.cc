@@ -25,6 +25,7 @@
 #include <QTranslator>
 
 #include "MainWindow.h"
+#include "StartupProfiler.h"
 
 void
 setupProxy()
@@ -55,18 +56,24 @@ setupProxy()
 int
 main(int argc, char *argv[])
 {
+        StartupProfiler::init(argc, argv);
+
         QCoreApplication::setApplicationName("nheko");
         QCoreApplication::setApplicationVersion("0.1.0");
         QCoreApplication::setOrganizationName("nheko");
         QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
+        StartupProfiler::beginPhase("QApplication");
         QApplication app(argc, argv);
+        StartupProfiler::endPhase("QApplication");
 
+        StartupProfiler::beginPhase("Font registration");
         QFontDatabase::addApplicationFont(":/fonts/fonts/OpenSans/OpenSans-Regular.ttf");
         QFontDatabase::addApplicationFont(":/fonts/fonts/OpenSans/OpenSans-Italic.ttf");
         QFontDatabase::addApplicationFont(":/fonts/fonts/OpenSans/OpenSans-Bold.ttf");
         QFontDatabase::addApplicationFont(":/fonts/fonts/OpenSans/OpenSans-Semibold.ttf");
         QFontDatabase::addApplicationFont(":/fonts/fonts/EmojiOne/emojione-android.ttf");
+        StartupProfiler::endPhase("Font registration");
 
         app.setWindowIcon(QIcon(":/logos/nheko.png"));
         qSetMessagePattern("%{time process}: [%{type}] - %{message}");
@@ -92,7 +99,9 @@ main(int argc, char *argv[])
 
         setupProxy();
 
+        StartupProfiler::beginPhase("MainWindow");
         MainWindow w;
+        StartupProfiler::endPhase("MainWindow");
 
         // Move the MainWindow to the center
         QRect screenGeometry = QApplication::desktop()->screenGeometry();
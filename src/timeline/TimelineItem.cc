@@ -16,21 +16,21 @@
  */
 
 #include <QFontDatabase>
-#include <QRegExp>
 #include <QTextEdit>
 
 #include "Avatar.h"
 #include "Config.h"
+#include "EventDispatch.h"
+#include "Utils.h"
 
+#include "emoji/Segmenter.h"
 #include "timeline/TimelineItem.h"
 #include "timeline/widgets/AudioItem.h"
 #include "timeline/widgets/FileItem.h"
 #include "timeline/widgets/ImageItem.h"
+#include "timeline/widgets/MessageLabel.h"
 #include "timeline/widgets/VideoItem.h"
 
-static const QRegExp URL_REGEX("((?:https?|ftp)://\\S+)");
-static const QString URL_HTML = "<a href=\"\\1\">\\1</a>";
-
 void
 TimelineItem::init()
 {
@@ -76,20 +76,17 @@ TimelineItem::TimelineItem(mtx::events::MessageType ty,
 {
         init();
 
-        auto displayName = TimelineViewManager::displayName(userid);
+        auto displayName = TimelineViewManager::displayName(Identifier(userid));
         auto timestamp   = QDateTime::currentDateTime();
 
         if (ty == mtx::events::MessageType::Emote) {
                 body            = QString("* %1 %2").arg(displayName).arg(body);
-                descriptionMsg_ = {"", userid, body, descriptiveTime(timestamp)};
+                descriptionMsg_ = {"", userid, body, descriptiveTime(timestamp), timestamp};
         } else {
-                descriptionMsg_ = {
-                  "You: ", userid, body, descriptiveTime(QDateTime::currentDateTime())};
+                descriptionMsg_ = {"You: ", userid, body, descriptiveTime(timestamp), timestamp};
         }
 
-        body = body.toHtmlEscaped();
-        body.replace(URL_REGEX, URL_HTML);
-        body.replace("\n", "<br/>");
+        body = utils::linkifyMessage(body);
         generateTimestamp(timestamp);
 
         if (withSender) {
@@ -97,7 +94,7 @@ TimelineItem::TimelineItem(mtx::events::MessageType ty,
                 setupAvatarLayout(displayName);
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(userid, this);
+                avatarUser_ = Identifier(userid);
         } else {
                 generateBody(body);
                 setupSimpleLayout();
@@ -154,7 +151,7 @@ TimelineItem::TimelineItem(ImageItem *image,
   : QWidget(parent)
 {
         setupWidgetLayout<mtx::events::RoomEvent<mtx::events::msg::Image>, ImageItem>(
-          image, event, " sent an image", with_sender);
+          image, event, with_sender);
 }
 
 TimelineItem::TimelineItem(FileItem *file,
@@ -164,7 +161,7 @@ TimelineItem::TimelineItem(FileItem *file,
   : QWidget(parent)
 {
         setupWidgetLayout<mtx::events::RoomEvent<mtx::events::msg::File>, FileItem>(
-          file, event, " sent a file", with_sender);
+          file, event, with_sender);
 }
 
 TimelineItem::TimelineItem(AudioItem *audio,
@@ -174,7 +171,7 @@ TimelineItem::TimelineItem(AudioItem *audio,
   : QWidget(parent)
 {
         setupWidgetLayout<mtx::events::RoomEvent<mtx::events::msg::Audio>, AudioItem>(
-          audio, event, " sent an audio clip", with_sender);
+          audio, event, with_sender);
 }
 
 TimelineItem::TimelineItem(VideoItem *video,
@@ -184,7 +181,7 @@ TimelineItem::TimelineItem(VideoItem *video,
   : QWidget(parent)
 {
         setupWidgetLayout<mtx::events::RoomEvent<mtx::events::msg::Video>, VideoItem>(
-          video, event, " sent a video clip", with_sender);
+          video, event, with_sender);
 }
 
 /*
@@ -198,21 +195,16 @@ TimelineItem::TimelineItem(const mtx::events::RoomEvent<mtx::events::msg::Notice
         init();
 
         event_id_         = QString::fromStdString(event.event_id);
-        const auto sender = QString::fromStdString(event.sender);
+        const auto sender = Identifier(event.sender);
 
-        descriptionMsg_ = {TimelineViewManager::displayName(sender),
-                           sender,
-                           " sent a notification",
-                           descriptiveTime(QDateTime::fromMSecsSinceEpoch(event.origin_server_ts))};
+        descriptionMsg_ = describe(event);
 
-        auto body      = QString::fromStdString(event.content.body).trimmed().toHtmlEscaped();
+        auto body      = QString::fromStdString(event.content.body).trimmed();
         auto timestamp = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
 
         generateTimestamp(timestamp);
 
-        body.replace(URL_REGEX, URL_HTML);
-        body.replace("\n", "<br/>");
-        body = "<i>" + body + "</i>";
+        body = "<i>" + utils::linkifyMessage(body) + "</i>";
 
         if (with_sender) {
                 auto displayName = TimelineViewManager::displayName(sender);
@@ -222,7 +214,7 @@ TimelineItem::TimelineItem(const mtx::events::RoomEvent<mtx::events::msg::Notice
 
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(sender, this);
+                avatarUser_ = sender;
         } else {
                 generateBody(body);
                 setupSimpleLayout();
@@ -242,29 +234,24 @@ TimelineItem::TimelineItem(const mtx::events::RoomEvent<mtx::events::msg::Emote>
         init();
 
         event_id_         = QString::fromStdString(event.event_id);
-        const auto sender = QString::fromStdString(event.sender);
+        const auto sender = Identifier(event.sender);
 
         auto body        = QString::fromStdString(event.content.body).trimmed();
         auto timestamp   = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
         auto displayName = TimelineViewManager::displayName(sender);
         auto emoteMsg    = QString("* %1 %2").arg(displayName).arg(body);
 
-        descriptionMsg_ = {"",
-                           sender,
-                           emoteMsg,
-                           descriptiveTime(QDateTime::fromMSecsSinceEpoch(event.origin_server_ts))};
+        descriptionMsg_ = describe(event);
 
         generateTimestamp(timestamp);
-        emoteMsg = emoteMsg.toHtmlEscaped();
-        emoteMsg.replace(URL_REGEX, URL_HTML);
-        emoteMsg.replace("\n", "<br/>");
+        emoteMsg = utils::linkifyMessage(emoteMsg);
 
         if (with_sender) {
                 generateBody(displayName, emoteMsg);
                 setupAvatarLayout(displayName);
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(sender, this);
+                avatarUser_ = sender;
         } else {
                 generateBody(emoteMsg);
                 setupSimpleLayout();
@@ -284,23 +271,17 @@ TimelineItem::TimelineItem(const mtx::events::RoomEvent<mtx::events::msg::Text>
         init();
 
         event_id_         = QString::fromStdString(event.event_id);
-        const auto sender = QString::fromStdString(event.sender);
+        const auto sender = Identifier(event.sender);
 
         auto body        = QString::fromStdString(event.content.body).trimmed();
         auto timestamp   = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
         auto displayName = TimelineViewManager::displayName(sender);
 
-        QSettings settings;
-        descriptionMsg_ = {sender == settings.value("auth/user_id") ? "You" : displayName,
-                           sender,
-                           QString(": %1").arg(body),
-                           descriptiveTime(QDateTime::fromMSecsSinceEpoch(event.origin_server_ts))};
+        descriptionMsg_ = describe(event);
 
         generateTimestamp(timestamp);
 
-        body = body.toHtmlEscaped();
-        body.replace(URL_REGEX, URL_HTML);
-        body.replace("\n", "<br/>");
+        body = utils::linkifyMessage(body);
 
         if (with_sender) {
                 generateBody(displayName, body);
@@ -308,7 +289,7 @@ TimelineItem::TimelineItem(const mtx::events::RoomEvent<mtx::events::msg::Text>
 
                 mainLayout_->addLayout(headerLayout_);
 
-                AvatarProvider::resolve(sender, this);
+                avatarUser_ = sender;
         } else {
                 generateBody(body);
                 setupSimpleLayout();
@@ -323,10 +304,10 @@ TimelineItem::generateBody(const QString &body)
 {
         QString content("<span> %1 </span>");
 
-        body_ = new QLabel(this);
+        body_ = new MessageLabel(this);
         body_->setFont(font_);
         body_->setWordWrap(true);
-        body_->setText(content.arg(replaceEmoji(body)));
+        body_->setText(content.arg(emoji::formatHtml(body)));
         body_->setMargin(0);
 
         body_->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::TextBrowserInteraction);
@@ -355,10 +336,10 @@ TimelineItem::generateBody(const QString &userid, const QString &body)
         if (body.isEmpty())
                 return;
 
-        body_ = new QLabel(this);
+        body_ = new MessageLabel(this);
         body_->setFont(font_);
         body_->setWordWrap(true);
-        body_->setText(QString("<span> %1 </span>").arg(replaceEmoji(body)));
+        body_->setText(QString("<span> %1 </span>").arg(emoji::formatHtml(body)));
         body_->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::TextBrowserInteraction);
         body_->setOpenExternalLinks(true);
         body_->setMargin(0);
@@ -381,27 +362,6 @@ TimelineItem::generateTimestamp(const QDateTime &time)
           QString("font-size: %1px;").arg(conf::timeline::fonts::timestamp));
 }
 
-QString
-TimelineItem::replaceEmoji(const QString &body)
-{
-        QString fmtBody = "";
-
-        QVector<uint> utf32_string = body.toUcs4();
-
-        for (auto &code : utf32_string) {
-                // TODO: Be more precise here.
-                if (code > 9000)
-                        fmtBody += QString("<span style=\"font-family: Emoji "
-                                           "One; font-size: %1px\">")
-                                     .arg(conf::emojiSize) +
-                                   QString::fromUcs4(&code, 1) + "</span>";
-                else
-                        fmtBody += QString::fromUcs4(&code, 1);
-        }
-
-        return fmtBody;
-}
-
 void
 TimelineItem::setupAvatarLayout(const QString &userName)
 {
@@ -474,8 +434,144 @@ TimelineItem::descriptiveTime(const QDateTime &then)
         return then.toString("dd/MM/yy");
 }
 
+template<class Event>
+DescInfo
+TimelineItem::describeMessage(const Event &event, const QString &body)
+{
+        const auto sender   = Identifier(event.sender);
+        const auto isOwn    = sender == Session::instance()->userIdentifier();
+        const auto datetime = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
+
+        return {isOwn ? "You" : TimelineViewManager::displayName(sender),
+                sender.toString(),
+                body,
+                descriptiveTime(datetime),
+                datetime};
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Audio> &event)
+{
+        return describeMessage(event, " sent an audio clip");
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Emote> &event)
+{
+        const auto sender   = Identifier(event.sender);
+        const auto body     = QString::fromStdString(event.content.body).trimmed();
+        const auto datetime = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
+
+        return {"",
+                sender.toString(),
+                QString("* %1 %2").arg(TimelineViewManager::displayName(sender)).arg(body),
+                descriptiveTime(datetime),
+                datetime};
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::File> &event)
+{
+        return describeMessage(event, " sent a file");
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Image> &event)
+{
+        return describeMessage(event, " sent an image");
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Notice> &event)
+{
+        const auto sender   = Identifier(event.sender);
+        const auto datetime = QDateTime::fromMSecsSinceEpoch(event.origin_server_ts);
+
+        return {TimelineViewManager::displayName(sender),
+                sender.toString(),
+                " sent a notification",
+                descriptiveTime(datetime),
+                datetime};
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Text> &event)
+{
+        const auto body = QString::fromStdString(event.content.body).trimmed();
+
+        return describeMessage(event, QString(": %1").arg(body));
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::RoomEvent<mtx::events::msg::Video> &event)
+{
+        return describeMessage(event, " sent a video clip");
+}
+
+namespace {
+struct MessageDescription
+{
+        using result_type = DescInfo;
+
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Audio> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Emote> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::File> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Image> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Notice> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Text> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+        DescInfo operator()(const mtx::events::RoomEvent<mtx::events::msg::Video> &e) const
+        {
+                return TimelineItem::describe(e);
+        }
+
+        DescInfo fallback() const { return DescInfo(); }
+};
+}
+
+DescInfo
+TimelineItem::describe(const mtx::events::collections::TimelineEvents &event)
+{
+        return dispatch::visit(MessageDescription{}, event);
+}
+
 TimelineItem::~TimelineItem() {}
 
+void
+TimelineItem::showEvent(QShowEvent *event)
+{
+        if (userAvatar_ && !isAvatarResolved_) {
+                isAvatarResolved_ = true;
+                AvatarProvider::resolve(avatarUser_, this);
+        }
+
+        QWidget::showEvent(event);
+}
+
+void
+TimelineItem::updateEstimatedHeight()
+{
+        if (body_ && body_->hasEstimatedHeight())
+                body_->updateGeometry();
+}
+
 void
 TimelineItem::paintEvent(QPaintEvent *)
 {
@@ -15,13 +15,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <iterator>
+
 #include <QApplication>
 #include <QFileInfo>
 #include <QTimer>
 
+#include "EventDispatch.h"
 #include "FloatingButton.h"
 #include "RoomMessages.h"
 #include "ScrollBar.h"
+#include "Session.h"
 
 #include "timeline/TimelineView.h"
 #include "timeline/widgets/AudioItem.h"
@@ -29,6 +34,45 @@
 #include "timeline/widgets/ImageItem.h"
 #include "timeline/widgets/VideoItem.h"
 
+namespace {
+namespace msg     = mtx::events::msg;
+using AudioEvent  = mtx::events::RoomEvent<msg::Audio>;
+using EmoteEvent  = mtx::events::RoomEvent<msg::Emote>;
+using FileEvent   = mtx::events::RoomEvent<msg::File>;
+using ImageEvent  = mtx::events::RoomEvent<msg::Image>;
+using NoticeEvent = mtx::events::RoomEvent<msg::Notice>;
+using TextEvent   = mtx::events::RoomEvent<msg::Text>;
+using VideoEvent  = mtx::events::RoomEvent<msg::Video>;
+
+// Every state and message event has a sender.
+struct EventSender
+{
+        using result_type = QString;
+
+        template<class Event>
+        auto operator()(const Event &event) const -> decltype(QString::fromStdString(event.sender))
+        {
+                return QString::fromStdString(event.sender);
+        }
+
+        QString fallback() const { return QString(""); }
+};
+
+struct EventId
+{
+        using result_type = QString;
+
+        template<class Event>
+        auto operator()(const Event &event) const
+          -> decltype(QString::fromStdString(event.event_id))
+        {
+                return QString::fromStdString(event.event_id);
+        }
+
+        QString fallback() const { return QString(""); }
+};
+}
+
 TimelineView::TimelineView(const mtx::responses::Timeline &timeline,
                            QSharedPointer<MatrixClient> client,
                            const QString &room_id,
@@ -56,6 +100,28 @@ TimelineView::sliderRangeChanged(int min, int max)
 {
         Q_UNUSED(min);
 
+        visibilityTimer_->start();
+
+        // Go back to the position the view had before it was destroyed. If the
+        // content isn't high enough yet, moving to the top triggers pagination.
+        if (isJumpingToBottom_) {
+                isJumpingToBottom_ = false;
+                scroll_area_->verticalScrollBar()->setValue(max);
+                return;
+        }
+
+        if (restoredOffset_ > 0) {
+                scroll_area_->verticalScrollBar()->setValue(qBound(0, max - restoredOffset_, max));
+
+                // The content might never get high enough, e.g when the history
+                // is exhausted or the width has changed since the offset was
+                // saved, so the offset is applied only until the view is loaded.
+                if (max >= restoredOffset_ || isTimelineFinished || isInitialized)
+                        restoredOffset_ = 0;
+
+                return;
+        }
+
         if (!scroll_area_->verticalScrollBar()->isVisible()) {
                 scroll_area_->verticalScrollBar()->setValue(max);
                 return;
@@ -87,7 +153,7 @@ TimelineView::fetchHistory()
 
         if (!hasEnoughMessages && !isTimelineFinished) {
                 isPaginationInProgress_ = true;
-                client_->messages(room_id_, prev_batch_token_);
+                requestMessages();
                 paginationTimer_->start(500);
                 return;
         }
@@ -101,9 +167,12 @@ TimelineView::scrollDown()
         int current = scroll_area_->verticalScrollBar()->value();
         int max     = scroll_area_->verticalScrollBar()->maximum();
 
-        // The first time we enter the room move the scroll bar to the bottom.
+        // The first time we enter the room move the scroll bar to the bottom,
+        // unless a previous position is going to be restored.
         if (!isInitialized) {
-                scroll_area_->verticalScrollBar()->setValue(max);
+                if (restoredOffset_ == 0)
+                        scroll_area_->verticalScrollBar()->setValue(max);
+
                 isInitialized = true;
                 return;
         }
@@ -114,9 +183,19 @@ TimelineView::scrollDown()
                 scroll_area_->verticalScrollBar()->setValue(max);
 }
 
+int
+TimelineView::scrollOffset() const
+{
+        const auto scrollbar = scroll_area_->verticalScrollBar();
+
+        return scrollbar->maximum() - scrollbar->value();
+}
+
 void
 TimelineView::sliderMoved(int position)
 {
+        visibilityTimer_->start();
+
         if (!scroll_area_->verticalScrollBar()->isVisible())
                 return;
 
@@ -143,20 +222,26 @@ TimelineView::sliderMoved(int position)
 
                 isPaginationInProgress_ = true;
 
-                // FIXME: Maybe move this to TimelineViewManager to remove the
-                // extra calls?
-                client_->messages(room_id_, prev_batch_token_);
+                requestMessages();
         }
 }
 
 void
-TimelineView::addBackwardsEvents(const QString &room_id, const mtx::responses::Messages &msgs)
+TimelineView::requestMessages()
 {
-        if (room_id_ != room_id)
-                return;
+        // The reply is delivered only to this view.
+        client_->messages(
+          room_id_, prev_batch_token_, this, [this](const mtx::responses::Messages &msgs) {
+                  addBackwardsEvents(msgs);
+          });
+}
 
+void
+TimelineView::addBackwardsEvents(const mtx::responses::Messages &msgs)
+{
         if (msgs.chunk.size() == 0) {
                 isTimelineFinished = true;
+                updateLoadedState();
                 return;
         }
 
@@ -182,66 +267,82 @@ TimelineView::addBackwardsEvents(const QString &room_id, const mtx::responses::M
         // Reverse again to render them.
         std::reverse(items.begin(), items.end());
 
-        oldPosition_ = scroll_area_->verticalScrollBar()->value();
-        oldHeight_   = scroll_widget_->size().height();
+        oldPosition_          = scroll_area_->verticalScrollBar()->value();
+        oldHeight_            = scroll_widget_->size().height();
+        lastMessageDirection_ = TimelineDirection::Top;
+
+        // Splice the whole page in without painting the intermediate states.
+        scroll_widget_->setUpdatesEnabled(false);
 
         for (const auto &item : items)
                 addTimelineItem(item, TimelineDirection::Top);
 
-        lastMessageDirection_ = TimelineDirection::Top;
+        // Run the layout pass now instead of on the next event loop iteration.
+        // The scroll area picks up the new height and sliderRangeChanged moves
+        // the scroll bar by the height of the page, so the first frame painted
+        // already shows the same messages in the same place.
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::LayoutRequest);
 
-        QApplication::processEvents();
+        scroll_widget_->setUpdatesEnabled(true);
 
         prev_batch_token_       = QString::fromStdString(msgs.end);
         isPaginationInProgress_ = false;
 
-        // Exclude the top stretch.
-        if (msgs.chunk.size() != 0 && scroll_layout_->count() > 1)
+        if (msgs.chunk.size() != 0 && hasItems())
                 notifyForLastEvent();
 
         // If this batch is the first being rendered (i.e the first and the last
         // events originate from this batch), set the last sender.
         if (lastSender_.isEmpty() && !items.isEmpty())
                 lastSender_ = items.constFirst()->descriptionMessage().userid;
+
+        updateLoadedState();
 }
 
 TimelineItem *
 TimelineView::parseMessageEvent(const mtx::events::collections::TimelineEvents &event,
                                 TimelineDirection direction)
 {
-        namespace msg     = mtx::events::msg;
-        using AudioEvent  = mtx::events::RoomEvent<msg::Audio>;
-        using EmoteEvent  = mtx::events::RoomEvent<msg::Emote>;
-        using FileEvent   = mtx::events::RoomEvent<msg::File>;
-        using ImageEvent  = mtx::events::RoomEvent<msg::Image>;
-        using NoticeEvent = mtx::events::RoomEvent<msg::Notice>;
-        using TextEvent   = mtx::events::RoomEvent<msg::Text>;
-        using VideoEvent  = mtx::events::RoomEvent<msg::Video>;
-
-        if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Audio>>(event)) {
-                auto audio = mpark::get<mtx::events::RoomEvent<msg::Audio>>(event);
-                return processMessageEvent<AudioEvent, AudioItem>(audio, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Emote>>(event)) {
-                auto emote = mpark::get<mtx::events::RoomEvent<msg::Emote>>(event);
-                return processMessageEvent<EmoteEvent>(emote, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::File>>(event)) {
-                auto file = mpark::get<mtx::events::RoomEvent<msg::File>>(event);
-                return processMessageEvent<FileEvent, FileItem>(file, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Image>>(event)) {
-                auto image = mpark::get<mtx::events::RoomEvent<msg::Image>>(event);
-                return processMessageEvent<ImageEvent, ImageItem>(image, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Notice>>(event)) {
-                auto notice = mpark::get<mtx::events::RoomEvent<msg::Notice>>(event);
-                return processMessageEvent<NoticeEvent>(notice, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Text>>(event)) {
-                auto text = mpark::get<mtx::events::RoomEvent<msg::Text>>(event);
-                return processMessageEvent<TextEvent>(text, direction);
-        } else if (mpark::holds_alternative<mtx::events::RoomEvent<msg::Video>>(event)) {
-                auto video = mpark::get<mtx::events::RoomEvent<msg::Video>>(event);
-                return processMessageEvent<VideoEvent, VideoItem>(video, direction);
-        }
-
-        return nullptr;
+        struct MessageParser
+        {
+                using result_type = TimelineItem *;
+
+                TimelineItem *operator()(const AudioEvent &audio) const
+                {
+                        return view->processMessageEvent<AudioEvent, AudioItem>(audio, direction);
+                }
+                TimelineItem *operator()(const EmoteEvent &emote) const
+                {
+                        return view->processMessageEvent<EmoteEvent>(emote, direction);
+                }
+                TimelineItem *operator()(const FileEvent &file) const
+                {
+                        return view->processMessageEvent<FileEvent, FileItem>(file, direction);
+                }
+                TimelineItem *operator()(const ImageEvent &image) const
+                {
+                        return view->processMessageEvent<ImageEvent, ImageItem>(image, direction);
+                }
+                TimelineItem *operator()(const NoticeEvent &notice) const
+                {
+                        return view->processMessageEvent<NoticeEvent>(notice, direction);
+                }
+                TimelineItem *operator()(const TextEvent &text) const
+                {
+                        return view->processMessageEvent<TextEvent>(text, direction);
+                }
+                TimelineItem *operator()(const VideoEvent &video) const
+                {
+                        return view->processMessageEvent<VideoEvent, VideoItem>(video, direction);
+                }
+
+                TimelineItem *fallback() const { return nullptr; }
+
+                TimelineView *view;
+                TimelineDirection direction;
+        };
+
+        return dispatch::visit(MessageParser{this, direction}, event);
 }
 
 int
@@ -249,44 +350,51 @@ TimelineView::addEvents(const mtx::responses::Timeline &timeline)
 {
         int message_count = 0;
 
-        QSettings settings;
-        QString localUser = settings.value("auth/user_id").toString();
-
         for (const auto &event : timeline.events) {
                 TimelineItem *item = parseMessageEvent(event, TimelineDirection::Bottom);
 
                 if (item != nullptr) {
                         addTimelineItem(item, TimelineDirection::Bottom);
 
-                        if (localUser != getEventSender(event))
+                        if (local_user_ != getEventSender(event))
                                 message_count += 1;
                 }
         }
 
         lastMessageDirection_ = TimelineDirection::Bottom;
 
-        QApplication::processEvents();
-
         if (isInitialSync) {
                 prev_batch_token_ = QString::fromStdString(timeline.prev_batch);
                 isInitialSync     = false;
         }
 
-        // Exclude the top stretch.
-        if (timeline.events.size() != 0 && scroll_layout_->count() > 1)
+        if (timeline.events.size() != 0 && hasItems())
                 notifyForLastEvent();
 
         if (isActiveWindow() && isVisible() && timeline.events.size() > 0)
                 readLastEvent();
 
+        updateLoadedState();
+
         return message_count;
 }
 
+void
+TimelineView::updateLoadedState()
+{
+        if (isLoaded_)
+                return;
+
+        if (hasItems() || isTimelineFinished) {
+                isLoaded_ = true;
+                emit loaded();
+        }
+}
+
 void
 TimelineView::init()
 {
-        QSettings settings;
-        local_user_ = settings.value("auth/user_id").toString();
+        local_user_ = Session::instance()->userId();
 
         QIcon icon;
         icon.addFile(":/icons/icons/ui/angle-arrow-down.png");
@@ -312,9 +420,16 @@ TimelineView::init()
 
         scroll_widget_ = new QWidget(this);
 
+        topSpacer_    = new QWidget(scroll_widget_);
+        bottomSpacer_ = new QWidget(scroll_widget_);
+        topSpacer_->setFixedHeight(0);
+        bottomSpacer_->setFixedHeight(0);
+
         scroll_layout_ = new QVBoxLayout(scroll_widget_);
         scroll_layout_->setContentsMargins(15, 0, 15, 15);
         scroll_layout_->addStretch(1);
+        scroll_layout_->addWidget(topSpacer_);
+        scroll_layout_->addWidget(bottomSpacer_);
         scroll_layout_->setSpacing(0);
         scroll_layout_->setObjectName("timelinescrollarea");
 
@@ -327,10 +442,12 @@ TimelineView::init()
         paginationTimer_ = new QTimer(this);
         connect(paginationTimer_, &QTimer::timeout, this, &TimelineView::fetchHistory);
 
-        connect(client_.data(),
-                &MatrixClient::messagesRetrieved,
-                this,
-                &TimelineView::addBackwardsEvents);
+        // Coalesces the visibility updates of a batch of scroll and layout
+        // changes into one pass after they have been processed.
+        visibilityTimer_ = new QTimer(this);
+        visibilityTimer_->setSingleShot(true);
+        visibilityTimer_->setInterval(0);
+        connect(visibilityTimer_, &QTimer::timeout, this, &TimelineView::updateVisibleItems);
 
         connect(scroll_area_->verticalScrollBar(),
                 SIGNAL(valueChanged(int)),
@@ -363,10 +480,299 @@ TimelineView::isSenderRendered(const QString &user_id, TimelineDirection directi
 void
 TimelineView::addTimelineItem(TimelineItem *item, TimelineDirection direction)
 {
+        const auto &hidden =
+          direction == TimelineDirection::Bottom ? hiddenBelow_ : hiddenAbove_;
+
+        if (!hidden.empty()) {
+                if (rows_.contains(item)) {
+                        // The new message is beyond the hidden ones, so it
+                        // goes straight to the hidden rows to keep the order.
+                        // The item is only measured. It fetches its avatar and
+                        // media when shown, so it hasn't made any requests.
+                        const int width = scroll_layout_->contentsRect().width();
+
+                        auto row   = rows_.take(item);
+                        row.height = item->hasHeightForWidth() ? item->heightForWidth(width)
+                                                               : item->sizeHint().height();
+
+                        item->deleteLater();
+
+                        if (direction == TimelineDirection::Bottom) {
+                                hiddenBelow_.push_back(row);
+                                hiddenBelowHeight_ += row.height;
+                        } else {
+                                hiddenAbove_.push_front(row);
+                                hiddenAboveHeight_ += row.height;
+                        }
+
+                        updateSpacers();
+                        return;
+                }
+
+                // Local echoes can't be rebuilt, so they are never hidden.
+                if (direction == TimelineDirection::Bottom)
+                        jumpToBottom();
+                else
+                        showHiddenRows(direction);
+        }
+
         if (direction == TimelineDirection::Bottom)
-                scroll_layout_->addWidget(item);
+                scroll_layout_->insertWidget(scroll_layout_->count() - 1, item);
         else
-                scroll_layout_->insertWidget(1, item);
+                scroll_layout_->insertWidget(FirstItemIndex, item);
+
+        visibilityTimer_->start();
+}
+
+void
+TimelineView::updateVisibleItems()
+{
+        // The geometry of hidden widgets isn't kept up to date.
+        if (!isVisible())
+                return;
+
+        const int viewportHeight = scroll_area_->viewport()->height();
+        const int top            = scroll_area_->verticalScrollBar()->value();
+        const int bottom         = top + viewportHeight;
+
+        const int keepMargin    = KeepMargin * viewportHeight;
+        const int discardMargin = DiscardMargin * viewportHeight;
+
+        while (scroll_layout_->count() > FirstItemIndex + 1) {
+                auto layoutItem = scroll_layout_->itemAt(FirstItemIndex);
+                auto item       = qobject_cast<TimelineItem *>(layoutItem->widget());
+
+                if (!item || !rows_.contains(item) ||
+                    item->geometry().bottom() >= top - discardMargin)
+                        break;
+
+                hideItem(item, TimelineDirection::Top);
+        }
+
+        while (scroll_layout_->count() > FirstItemIndex + 1) {
+                auto layoutItem = scroll_layout_->itemAt(scroll_layout_->count() - 2);
+                auto item       = qobject_cast<TimelineItem *>(layoutItem->widget());
+
+                if (!item || !rows_.contains(item) ||
+                    item->geometry().top() <= bottom + discardMargin)
+                        break;
+
+                hideItem(item, TimelineDirection::Bottom);
+        }
+
+        if (!hiddenAbove_.empty() && topSpacer_->geometry().bottom() >= top - keepMargin) {
+                // Anchor the scroll bar like with paginated messages, in case
+                // the width has changed since the heights were measured.
+                oldPosition_          = top;
+                oldHeight_            = scroll_widget_->size().height();
+                lastMessageDirection_ = TimelineDirection::Top;
+
+                int restoredHeight = 0;
+
+                while (!hiddenAbove_.empty() && restoredHeight < keepMargin) {
+                        const auto row = hiddenAbove_.back();
+                        hiddenAbove_.pop_back();
+
+                        hiddenAboveHeight_ -= row.height;
+                        restoredHeight += row.height;
+
+                        auto item = restoreItem(row);
+
+                        if (item)
+                                scroll_layout_->insertWidget(FirstItemIndex, item);
+                }
+        }
+
+        if (!hiddenBelow_.empty() && bottomSpacer_->geometry().top() <= bottom + keepMargin) {
+                int restoredHeight = 0;
+
+                while (!hiddenBelow_.empty() && restoredHeight < keepMargin) {
+                        const auto row = hiddenBelow_.front();
+                        hiddenBelow_.pop_front();
+
+                        hiddenBelowHeight_ -= row.height;
+                        restoredHeight += row.height;
+
+                        auto item = restoreItem(row);
+
+                        if (item)
+                                scroll_layout_->insertWidget(scroll_layout_->count() - 1, item);
+                }
+        }
+
+        // Bodies laid out while off screen have an estimated height, which
+        // is replaced by the exact one once they are visible.
+        for (int i = FirstItemIndex; i < scroll_layout_->count() - 1; ++i) {
+                auto item = qobject_cast<TimelineItem *>(scroll_layout_->itemAt(i)->widget());
+
+                if (!item || item->geometry().bottom() < top)
+                        continue;
+
+                if (item->geometry().top() > bottom)
+                        break;
+
+                item->updateEstimatedHeight();
+        }
+
+        updateSpacers();
+}
+
+void
+TimelineView::hideItem(TimelineItem *item, TimelineDirection direction)
+{
+        auto row   = rows_.take(item);
+        row.height = item->height();
+
+        scroll_layout_->removeWidget(item);
+        item->hide();
+        item->deleteLater();
+
+        if (direction == TimelineDirection::Top) {
+                hiddenAbove_.push_back(row);
+                hiddenAboveHeight_ += row.height;
+        } else {
+                hiddenBelow_.push_front(row);
+                hiddenBelowHeight_ += row.height;
+        }
+
+        updateSpacers();
+}
+
+void
+TimelineView::showHiddenRows(TimelineDirection direction)
+{
+        if (direction == TimelineDirection::Top) {
+                while (!hiddenAbove_.empty()) {
+                        auto item = restoreItem(hiddenAbove_.back());
+                        hiddenAbove_.pop_back();
+
+                        if (item)
+                                scroll_layout_->insertWidget(FirstItemIndex, item);
+                }
+
+                hiddenAboveHeight_ = 0;
+        } else {
+                while (!hiddenBelow_.empty()) {
+                        auto item = restoreItem(hiddenBelow_.front());
+                        hiddenBelow_.pop_front();
+
+                        if (item)
+                                scroll_layout_->insertWidget(scroll_layout_->count() - 1, item);
+                }
+
+                hiddenBelowHeight_ = 0;
+        }
+
+        updateSpacers();
+}
+
+void
+TimelineView::jumpToBottom()
+{
+        while (scroll_layout_->count() > FirstItemIndex + 1) {
+                auto layoutItem = scroll_layout_->itemAt(FirstItemIndex);
+                auto item       = qobject_cast<TimelineItem *>(layoutItem->widget());
+
+                if (!item || !rows_.contains(item))
+                        break;
+
+                hideItem(item, TimelineDirection::Top);
+        }
+
+        // An earlier echo that is still waiting for its event can't be hidden
+        // either. The rows below it arrived after it was sent, so they are few.
+        if (scroll_layout_->count() > FirstItemIndex + 1) {
+                showHiddenRows(TimelineDirection::Bottom);
+                return;
+        }
+
+        std::move(hiddenBelow_.begin(), hiddenBelow_.end(), std::back_inserter(hiddenAbove_));
+        hiddenAboveHeight_ += hiddenBelowHeight_;
+
+        hiddenBelow_.clear();
+        hiddenBelowHeight_ = 0;
+
+        // Only the end of the timeline is rebuilt. The rest comes back from
+        // the hidden rows while scrolling up.
+        const int keepMargin = KeepMargin * scroll_area_->viewport()->height();
+        int restoredHeight   = 0;
+
+        while (!hiddenAbove_.empty() && restoredHeight < keepMargin) {
+                const auto row = hiddenAbove_.back();
+                hiddenAbove_.pop_back();
+
+                hiddenAboveHeight_ -= row.height;
+                restoredHeight += row.height;
+
+                auto item = restoreItem(row);
+
+                if (item)
+                        scroll_layout_->insertWidget(FirstItemIndex, item);
+        }
+
+        updateSpacers();
+
+        isJumpingToBottom_ = true;
+}
+
+TimelineItem *
+TimelineView::restoreItem(const TimelineRow &row)
+{
+        struct ItemBuilder
+        {
+                using result_type = TimelineItem *;
+
+                TimelineItem *operator()(const AudioEvent &audio) const
+                {
+                        return view->createTimelineItem<AudioEvent, AudioItem>(audio, withSender);
+                }
+                TimelineItem *operator()(const EmoteEvent &emote) const
+                {
+                        return view->createTimelineItem<EmoteEvent>(emote, withSender);
+                }
+                TimelineItem *operator()(const FileEvent &file) const
+                {
+                        return view->createTimelineItem<FileEvent, FileItem>(file, withSender);
+                }
+                TimelineItem *operator()(const ImageEvent &image) const
+                {
+                        return view->createTimelineItem<ImageEvent, ImageItem>(image, withSender);
+                }
+                TimelineItem *operator()(const NoticeEvent &notice) const
+                {
+                        return view->createTimelineItem<NoticeEvent>(notice, withSender);
+                }
+                TimelineItem *operator()(const TextEvent &text) const
+                {
+                        return view->createTimelineItem<TextEvent>(text, withSender);
+                }
+                TimelineItem *operator()(const VideoEvent &video) const
+                {
+                        return view->createTimelineItem<VideoEvent, VideoItem>(video, withSender);
+                }
+
+                TimelineItem *fallback() const { return nullptr; }
+
+                TimelineView *view;
+                bool withSender;
+        };
+
+        return dispatch::visit(ItemBuilder{this, row.withSender}, row.event);
+}
+
+void
+TimelineView::updateSpacers()
+{
+        topSpacer_->setFixedHeight(hiddenAboveHeight_);
+        bottomSpacer_->setFixedHeight(hiddenBelowHeight_);
+}
+
+bool
+TimelineView::hasItems() const
+{
+        // Exclude the top stretch and the spacers.
+        return scroll_layout_->count() > FirstItemIndex + 1 || !hiddenAbove_.empty() ||
+               !hiddenBelow_.empty();
 }
 
 void
@@ -385,27 +791,25 @@ TimelineView::updatePendingMessage(int txn_id, QString event_id)
 void
 TimelineView::addUserMessage(mtx::events::MessageType ty, const QString &body)
 {
-        QSettings settings;
-        auto user_id     = settings.value("auth/user_id").toString();
-        auto with_sender = lastSender_ != user_id;
+        const auto &user_id = local_user_;
+        auto with_sender    = lastSender_ != user_id;
 
         TimelineItem *view_item = new TimelineItem(ty, user_id, body, with_sender, scroll_widget_);
-        scroll_layout_->addWidget(view_item);
+        addTimelineItem(view_item, TimelineDirection::Bottom);
 
         lastMessageDirection_ = TimelineDirection::Bottom;
 
-        QApplication::processEvents();
-
         lastSender_ = user_id;
 
         int txn_id = client_->incrementTransactionId();
-        PendingMessage message(ty, txn_id, body, "", "", view_item);
+        PendingMessage message(ty, txn_id, body, "", "", view_item, with_sender);
         handleNewUserMessage(message);
 }
 
 void
 TimelineView::handleNewUserMessage(PendingMessage msg)
 {
+        pendingTxnIds_.insert(msg.txn_id);
         pending_msgs_.enqueue(msg);
         if (pending_msgs_.size() == 1 && pending_sent_msgs_.isEmpty())
                 sendNextPendingMessage();
@@ -439,7 +843,14 @@ TimelineView::sendNextPendingMessage()
 void
 TimelineView::notifyForLastEvent()
 {
-        auto lastItem          = scroll_layout_->itemAt(scroll_layout_->count() - 1);
+        if (!hiddenBelow_.empty()) {
+                const auto info = TimelineItem::describe(hiddenBelow_.back().event);
+                emit updateLastTimelineMessage(room_id_, info);
+                return;
+        }
+
+        // Skip the bottom spacer.
+        auto lastItem          = scroll_layout_->itemAt(scroll_layout_->count() - 2);
         auto *lastTimelineItem = qobject_cast<TimelineItem *>(lastItem->widget());
 
         if (lastTimelineItem)
@@ -448,6 +859,18 @@ TimelineView::notifyForLastEvent()
                 qWarning() << "Cast to TimelineView failed" << room_id_;
 }
 
+void
+TimelineView::addEventId(const QString &event_id)
+{
+        eventIds_.insert(event_id);
+        eventIdOrder_.push_back(event_id);
+
+        if (eventIdOrder_.size() > MaxEventIds) {
+                eventIds_.remove(eventIdOrder_.front());
+                eventIdOrder_.pop_front();
+        }
+}
+
 bool
 TimelineView::isPendingMessage(const QString &txnid,
                                const QString &sender,
@@ -456,24 +879,24 @@ TimelineView::isPendingMessage(const QString &txnid,
         if (sender != local_userid)
                 return false;
 
-        for (const auto &msg : pending_msgs_) {
-                if (QString::number(msg.txn_id) == txnid)
-                        return true;
-        }
+        bool isNumber    = false;
+        const int txn_id = txnid.toInt(&isNumber);
 
-        for (const auto &msg : pending_sent_msgs_) {
-                if (QString::number(msg.txn_id) == txnid)
-                        return true;
-        }
-
-        return false;
+        return isNumber && pendingTxnIds_.contains(txn_id);
 }
 
 void
-TimelineView::removePendingMessage(const QString &txnid)
+TimelineView::removePendingMessage(const QString &txnid,
+                                   const mtx::events::collections::TimelineEvents &event)
 {
+        const int txn_id = txnid.toInt();
+
+        pendingTxnIds_.remove(txn_id);
+
         for (auto it = pending_sent_msgs_.begin(); it != pending_sent_msgs_.end(); ++it) {
-                if (QString::number(it->txn_id) == txnid) {
+                if (it->txn_id == txn_id) {
+                        rows_.insert(it->widget, TimelineRow{event, it->with_sender, 0});
+
                         int index = std::distance(pending_sent_msgs_.begin(), it);
                         pending_sent_msgs_.removeAt(index);
 
@@ -484,7 +907,9 @@ TimelineView::removePendingMessage(const QString &txnid)
                 }
         }
         for (auto it = pending_msgs_.begin(); it != pending_msgs_.end(); ++it) {
-                if (QString::number(it->txn_id) == txnid) {
+                if (it->txn_id == txn_id) {
+                        rows_.insert(it->widget, TimelineRow{event, it->with_sender, 0});
+
                         int index = std::distance(pending_msgs_.begin(), it);
                         pending_msgs_.removeAt(index);
                         return;
@@ -521,6 +946,14 @@ TimelineView::readLastEvent() const
 QString
 TimelineView::getLastEventId() const
 {
+        // The newest messages might be hidden.
+        for (auto it = hiddenBelow_.crbegin(); it != hiddenBelow_.crend(); ++it) {
+                const auto eventId = dispatch::visit(EventId{}, it->event);
+
+                if (!eventId.isEmpty())
+                        return eventId;
+        }
+
         auto index = scroll_layout_->count();
 
         // Search backwards for the first event that has a valid event id.
@@ -541,6 +974,7 @@ void
 TimelineView::showEvent(QShowEvent *event)
 {
         readLastEvent();
+        visibilityTimer_->start();
 
         QWidget::showEvent(event);
 }
@@ -561,77 +995,5 @@ TimelineView::event(QEvent *event)
 QString
 TimelineView::getEventSender(const mtx::events::collections::TimelineEvents &event) const
 {
-        using Aliases           = mtx::events::StateEvent<mtx::events::state::Aliases>;
-        using Avatar            = mtx::events::StateEvent<mtx::events::state::Avatar>;
-        using CanonicalAlias    = mtx::events::StateEvent<mtx::events::state::CanonicalAlias>;
-        using Create            = mtx::events::StateEvent<mtx::events::state::Create>;
-        using HistoryVisibility = mtx::events::StateEvent<mtx::events::state::HistoryVisibility>;
-        using JoinRules         = mtx::events::StateEvent<mtx::events::state::JoinRules>;
-        using Member            = mtx::events::StateEvent<mtx::events::state::Member>;
-        using Name              = mtx::events::StateEvent<mtx::events::state::Name>;
-        using PowerLevels       = mtx::events::StateEvent<mtx::events::state::PowerLevels>;
-        using Topic             = mtx::events::StateEvent<mtx::events::state::Topic>;
-
-        using Audio  = mtx::events::RoomEvent<mtx::events::msg::Audio>;
-        using Emote  = mtx::events::RoomEvent<mtx::events::msg::Emote>;
-        using File   = mtx::events::RoomEvent<mtx::events::msg::File>;
-        using Image  = mtx::events::RoomEvent<mtx::events::msg::Image>;
-        using Notice = mtx::events::RoomEvent<mtx::events::msg::Notice>;
-        using Text   = mtx::events::RoomEvent<mtx::events::msg::Text>;
-        using Video  = mtx::events::RoomEvent<mtx::events::msg::Video>;
-
-        if (mpark::holds_alternative<Aliases>(event)) {
-                auto msg = mpark::get<Aliases>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Avatar>(event)) {
-                auto msg = mpark::get<Avatar>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<CanonicalAlias>(event)) {
-                auto msg = mpark::get<CanonicalAlias>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Create>(event)) {
-                auto msg = mpark::get<Create>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<HistoryVisibility>(event)) {
-                auto msg = mpark::get<HistoryVisibility>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<JoinRules>(event)) {
-                auto msg = mpark::get<JoinRules>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Name>(event)) {
-                auto msg = mpark::get<Name>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Member>(event)) {
-                auto msg = mpark::get<Member>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<PowerLevels>(event)) {
-                auto msg = mpark::get<PowerLevels>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Topic>(event)) {
-                auto msg = mpark::get<Topic>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Audio>(event)) {
-                auto msg = mpark::get<Audio>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Emote>(event)) {
-                auto msg = mpark::get<Emote>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<File>(event)) {
-                auto msg = mpark::get<File>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Image>(event)) {
-                auto msg = mpark::get<Image>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Notice>(event)) {
-                auto msg = mpark::get<Notice>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Text>(event)) {
-                auto msg = mpark::get<Text>(event);
-                return QString::fromStdString(msg.sender);
-        } else if (mpark::holds_alternative<Video>(event)) {
-                auto msg = mpark::get<Video>(event);
-                return QString::fromStdString(msg.sender);
-        }
-
-        return QString("");
+        return dispatch::visit(EventSender{}, event);
 }
@@ -15,6 +15,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <random>
 
 #include <QApplication>
@@ -23,7 +24,9 @@
 #include <QSettings>
 
 #include "MatrixClient.h"
+#include "Session.h"
 
+#include "timeline/TimelineItem.h"
 #include "timeline/TimelineView.h"
 #include "timeline/TimelineViewManager.h"
 #include "timeline/widgets/AudioItem.h"
@@ -36,6 +39,9 @@ TimelineViewManager::TimelineViewManager(QSharedPointer<MatrixClient> client, QW
 {
         setStyleSheet("border: none;");
 
+        QSettings settings;
+        maxViews_ = std::max(1, settings.value("user/timeline/max_views", DefaultMaxViews).toInt());
+
         connect(
           client_.data(), &MatrixClient::messageSent, this, &TimelineViewManager::messageSent);
 
@@ -50,26 +56,28 @@ TimelineViewManager::~TimelineViewManager() {}
 void
 TimelineViewManager::messageSent(const QString &event_id, const QString &roomid, int txn_id)
 {
-        // We save the latest valid transaction ID for later use.
-        QSettings settings;
-        settings.setValue("client/transaction_id", txn_id + 1);
+        auto view = views_.value(roomid);
 
-        auto view = views_[roomid];
-        view->updatePendingMessage(txn_id, event_id);
+        if (!view.isNull())
+                view->updatePendingMessage(txn_id, event_id);
 }
 
 void
 TimelineViewManager::messageSendFailed(const QString &roomid, int txn_id)
 {
-        auto view = views_[roomid];
-        view->handleFailedMessage(txn_id);
+        auto view = views_.value(roomid);
+
+        if (!view.isNull())
+                view->handleFailedMessage(txn_id);
 }
 
 void
 TimelineViewManager::queueTextMessage(const QString &msg)
 {
-        auto room_id = active_room_;
-        auto view    = views_[room_id];
+        auto view = timelineView(active_room_);
+
+        if (view.isNull())
+                return;
 
         view->addUserMessage(mtx::events::MessageType::Text, msg);
 }
@@ -77,8 +85,10 @@ TimelineViewManager::queueTextMessage(const QString &msg)
 void
 TimelineViewManager::queueEmoteMessage(const QString &msg)
 {
-        auto room_id = active_room_;
-        auto view    = views_[room_id];
+        auto view = timelineView(active_room_);
+
+        if (view.isNull())
+                return;
 
         view->addUserMessage(mtx::events::MessageType::Emote, msg);
 }
@@ -88,13 +98,13 @@ TimelineViewManager::queueImageMessage(const QString &roomid,
                                        const QString &filename,
                                        const QString &url)
 {
-        if (!views_.contains(roomid)) {
+        auto view = timelineView(roomid);
+
+        if (view.isNull()) {
                 qDebug() << "Cannot send m.image message to a non-managed view";
                 return;
         }
 
-        auto view = views_[roomid];
-
         view->addUserMessage<ImageItem, mtx::events::MessageType::Image>(url, filename);
 }
 
@@ -103,13 +113,13 @@ TimelineViewManager::queueFileMessage(const QString &roomid,
                                       const QString &filename,
                                       const QString &url)
 {
-        if (!views_.contains(roomid)) {
+        auto view = timelineView(roomid);
+
+        if (view.isNull()) {
                 qDebug() << "Cannot send m.file message to a non-managed view";
                 return;
         }
 
-        auto view = views_[roomid];
-
         view->addUserMessage<FileItem, mtx::events::MessageType::File>(url, filename);
 }
 
@@ -118,13 +128,13 @@ TimelineViewManager::queueAudioMessage(const QString &roomid,
                                        const QString &filename,
                                        const QString &url)
 {
-        if (!views_.contains(roomid)) {
+        auto view = timelineView(roomid);
+
+        if (view.isNull()) {
                 qDebug() << "Cannot send m.audio message to a non-managed view";
                 return;
         }
 
-        auto view = views_[roomid];
-
         view->addUserMessage<AudioItem, mtx::events::MessageType::Audio>(url, filename);
 }
 
@@ -135,14 +145,9 @@ TimelineViewManager::clearAll()
                 removeWidget(view.data());
 
         views_.clear();
-}
-
-void
-TimelineViewManager::initialize(const mtx::responses::Rooms &rooms)
-{
-        for (auto it = rooms.join.cbegin(); it != rooms.join.cend(); ++it) {
-                addRoom(it->second, QString::fromStdString(it->first));
-        }
+        timelines_.clear();
+        recentRooms_.clear();
+        scrollOffsets_.clear();
 }
 
 void
@@ -156,28 +161,63 @@ TimelineViewManager::initialize(const QList<QString> &rooms)
 void
 TimelineViewManager::addRoom(const mtx::responses::JoinedRoom &room, const QString &room_id)
 {
-        // Create a history view with the room events.
-        TimelineView *view = new TimelineView(room.timeline, client_, room_id);
-        views_.insert(room_id, QSharedPointer<TimelineView>(view));
-
-        connect(view,
-                &TimelineView::updateLastTimelineMessage,
-                this,
-                &TimelineViewManager::updateRoomsLastMessage);
-        connect(view,
-                &TimelineView::clearUnreadMessageCount,
-                this,
-                &TimelineViewManager::clearRoomMessageCount);
+        if (timelines_.contains(room_id))
+                return;
 
-        // Add the view in the widget stack.
-        addWidget(view);
+        // The view is created with these events when the room is opened.
+        timelines_.insert(room_id, room.timeline);
 }
 
 void
 TimelineViewManager::addRoom(const QString &room_id)
 {
-        // Create a history view without any events.
-        TimelineView *view = new TimelineView(client_, room_id);
+        if (timelines_.contains(room_id))
+                return;
+
+        timelines_.insert(room_id, mtx::responses::Timeline());
+}
+
+QMap<QString, DescInfo>
+TimelineViewManager::lastMessages() const
+{
+        QMap<QString, DescInfo> messages;
+
+        for (auto it = timelines_.constBegin(); it != timelines_.constEnd(); ++it) {
+                const auto &events = it.value().events;
+
+                for (auto event = events.rbegin(); event != events.rend(); ++event) {
+                        const auto info = TimelineItem::describe(*event);
+
+                        if (!info.userid.isEmpty()) {
+                                messages.insert(it.key(), info);
+                                break;
+                        }
+                }
+        }
+
+        return messages;
+}
+
+QSharedPointer<TimelineView>
+TimelineViewManager::timelineView(const QString &room_id)
+{
+        auto view = views_.value(room_id);
+
+        if (view.isNull() && timelines_.contains(room_id))
+                return createView(room_id);
+
+        return view;
+}
+
+QSharedPointer<TimelineView>
+TimelineViewManager::createView(const QString &room_id)
+{
+        const auto timeline = timelines_.value(room_id);
+
+        // Create a history view with the buffered events, if any.
+        TimelineView *view = timeline.events.empty()
+                               ? new TimelineView(client_, room_id)
+                               : new TimelineView(timeline, client_, room_id);
         views_.insert(room_id, QSharedPointer<TimelineView>(view));
 
         connect(view,
@@ -188,55 +228,132 @@ TimelineViewManager::addRoom(const QString &room_id)
                 &TimelineView::clearUnreadMessageCount,
                 this,
                 &TimelineViewManager::clearRoomMessageCount);
+        connect(view, &TimelineView::loaded, this, [this, room_id]() {
+                if (room_id == active_room_)
+                        emit activeTimelineLoaded();
+        });
+
+        if (scrollOffsets_.contains(room_id))
+                view->restoreScrollOffset(scrollOffsets_.take(room_id));
+
+        recentRooms_.append(room_id);
 
         // Add the view in the widget stack.
         addWidget(view);
+
+        return views_.value(room_id);
+}
+
+void
+TimelineViewManager::bufferEvents(const QString &room_id, const mtx::responses::Timeline &timeline)
+{
+        auto &buffer = timelines_[room_id];
+
+        // A limited timeline leaves a gap after the buffered events, so only
+        // the newest batch is kept and the rest is fetched by pagination.
+        if (buffer.events.empty() || timeline.limited ||
+            buffer.events.size() + timeline.events.size() > MaxBufferedEvents) {
+                buffer = timeline;
+                return;
+        }
+
+        buffer.events.insert(buffer.events.end(), timeline.events.begin(), timeline.events.end());
 }
 
 void
 TimelineViewManager::sync(const mtx::responses::Rooms &rooms)
 {
+        // TODO: When the app window gets active the current
+        // unread count (if any) should be cleared.
+        auto isAppActive = QApplication::activeWindow() != nullptr;
+
         for (auto it = rooms.join.cbegin(); it != rooms.join.cend(); ++it) {
                 auto roomid = QString::fromStdString(it->first);
 
-                if (!views_.contains(roomid)) {
+                if (!timelines_.contains(roomid)) {
                         qDebug() << "Ignoring event from unknown room" << roomid;
                         continue;
                 }
 
-                auto view = views_.value(roomid);
+                bufferEvents(roomid, it->second.timeline);
+
+                int msgs_added = 0;
 
-                int msgs_added = view->addEvents(it->second.timeline);
+                if (views_.contains(roomid)) {
+                        msgs_added = views_.value(roomid)->addEvents(it->second.timeline);
+                } else {
+                        const auto &events   = it->second.timeline.events;
+                        const auto localUser = Session::instance()->userIdentifier();
 
-                if (msgs_added > 0) {
-                        // TODO: When the app window gets active the current
-                        // unread count (if any) should be cleared.
-                        auto isAppActive = QApplication::activeWindow() != nullptr;
+                        DescInfo lastMessage;
 
-                        if (roomid != active_room_ || !isAppActive)
-                                emit unreadMessages(roomid, msgs_added);
+                        for (const auto &event : events) {
+                                const auto info = TimelineItem::describe(event);
+
+                                if (info.userid.isEmpty())
+                                        continue;
+
+                                if (Identifier(info.userid) != localUser)
+                                        msgs_added += 1;
+
+                                lastMessage = info;
+                        }
+
+                        if (!lastMessage.userid.isEmpty())
+                                emit updateRoomsLastMessage(roomid, lastMessage);
                 }
+
+                if (msgs_added > 0 && (roomid != active_room_ || !isAppActive))
+                        emit unreadMessages(roomid, msgs_added);
         }
 }
 
 void
 TimelineViewManager::setHistoryView(const QString &room_id)
 {
-        if (!views_.contains(room_id)) {
+        auto view = timelineView(room_id);
+
+        if (view.isNull()) {
                 qDebug() << "Room ID from RoomList is not present in ViewManager" << room_id;
                 return;
         }
 
         active_room_ = room_id;
-        auto view    = views_.value(room_id);
+
+        recentRooms_.removeOne(room_id);
+        recentRooms_.prepend(room_id);
 
         setCurrentWidget(view.data());
 
         view->fetchHistory();
         view->scrollDown();
+
+        if (view->hasLoaded())
+                emit activeTimelineLoaded();
+
+        evictViews();
+}
+
+void
+TimelineViewManager::evictViews()
+{
+        for (int i = recentRooms_.size() - 1; i >= 0 && views_.size() > maxViews_; --i) {
+                const auto room_id = recentRooms_.at(i);
+                const auto view    = views_.value(room_id);
+
+                // Local echoes can't be recreated from the buffered events.
+                if (room_id == active_room_ || view->hasPendingMessages())
+                        continue;
+
+                scrollOffsets_.insert(room_id, view->scrollOffset());
+                recentRooms_.removeAt(i);
+
+                removeWidget(view.data());
+                views_.remove(room_id);
+        }
 }
 
-QMap<QString, QString> TimelineViewManager::DISPLAY_NAMES;
+QHash<Identifier, QString> TimelineViewManager::DISPLAY_NAMES;
 
 QString
 TimelineViewManager::chooseRandomColor()
@@ -297,20 +414,12 @@ TimelineViewManager::chooseRandomColor()
 }
 
 QString
-TimelineViewManager::displayName(const QString &userid)
+TimelineViewManager::displayName(const Identifier &userid)
 {
-        if (DISPLAY_NAMES.contains(userid))
-                return DISPLAY_NAMES.value(userid);
+        auto it = DISPLAY_NAMES.constFind(userid);
 
-        return userid;
-}
-
-bool
-TimelineViewManager::hasLoaded() const
-{
-        for (const auto &view : views_)
-                if (!view->hasLoaded())
-                        return false;
+        if (it != DISPLAY_NAMES.constEnd())
+                return it.value();
 
-        return true;
+        return userid.toString();
 }
@@ -63,7 +63,6 @@ AudioItem::init()
         player_->setVolume(100);
         player_->setNotifyInterval(1000);
 
-        connect(client_.data(), &MatrixClient::fileDownloaded, this, &AudioItem::fileDownloaded);
         connect(player_, &QMediaPlayer::stateChanged, this, [=](QMediaPlayer::State state) {
                 if (state == QMediaPlayer::StoppedState) {
                         state_ = AudioState::Play;
@@ -148,16 +147,14 @@ AudioItem::mousePressEvent(QMouseEvent *event)
                 if (filenameToSave_.isEmpty())
                         return;
 
-                client_->downloadFile(QString::fromStdString(event_.event_id), url_);
+                client_->downloadFile(
+                  url_, this, [this](const QByteArray &data) { fileDownloaded(data); });
         }
 }
 
 void
-AudioItem::fileDownloaded(const QString &event_id, const QByteArray &data)
+AudioItem::fileDownloaded(const QByteArray &data)
 {
-        if (event_id != QString::fromStdString(event_.event_id))
-                return;
-
         try {
                 QFile file(filenameToSave_);
 
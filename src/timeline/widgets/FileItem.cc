@@ -56,8 +56,6 @@ FileItem::init()
         QString media_params = url_parts[1];
         url_                 = QString("%1/_matrix/media/r0/download/%2")
                  .arg(client_.data()->getHomeServer().toString(), media_params);
-
-        connect(client_.data(), &MatrixClient::fileDownloaded, this, &FileItem::fileDownloaded);
 }
 
 FileItem::FileItem(QSharedPointer<MatrixClient> client,
@@ -135,18 +133,16 @@ FileItem::mousePressEvent(QMouseEvent *event)
                 if (filenameToSave_.isEmpty())
                         return;
 
-                client_->downloadFile(QString::fromStdString(event_.event_id), url_);
+                client_->downloadFile(
+                  url_, this, [this](const QByteArray &data) { fileDownloaded(data); });
         } else {
                 openUrl();
         }
 }
 
 void
-FileItem::fileDownloaded(const QString &event_id, const QByteArray &data)
+FileItem::fileDownloaded(const QByteArray &data)
 {
-        if (event_id != QString::fromStdString(event_.event_id))
-                return;
-
         try {
                 QFile file(filenameToSave_);
 
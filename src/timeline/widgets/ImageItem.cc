@@ -15,6 +15,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QApplication>
 #include <QBrush>
 #include <QDebug>
 #include <QDesktopServices>
@@ -22,6 +23,8 @@
 #include <QPainter>
 #include <QPixmap>
 
+#include "ImageCache.h"
+#include "Utils.h"
 #include "dialogs/ImageOverlay.h"
 #include "timeline/widgets/ImageItem.h"
 
@@ -36,26 +39,48 @@ ImageItem::ImageItem(QSharedPointer<MatrixClient> client,
         setCursor(Qt::PointingHandCursor);
         setAttribute(Qt::WA_Hover, true);
 
-        url_  = QString::fromStdString(event.content.url);
-        text_ = QString::fromStdString(event.content.body);
+        const auto mxcUrl = QString::fromStdString(event.content.url);
+        text_             = QString::fromStdString(event.content.body);
+        url_              = utils::mediaDownloadUrl(client_->getHomeServer(), mxcUrl);
+        mediaId_          = mxcUrl;
 
-        QList<QString> url_parts = url_.toString().split("mxc://");
-
-        if (url_parts.size() != 2) {
-                qDebug() << "Invalid format for image" << url_.toString();
+        if (!url_.isValid()) {
+                qDebug() << "Invalid format for image" << mxcUrl;
                 return;
         }
 
-        QString media_params = url_parts[1];
-        url_                 = QString("%1/_matrix/media/r0/download/%2")
-                 .arg(client_.data()->getHomeServer().toString(), media_params);
+        // The thumbnail is still cached if the timeline has been recreated.
+        const auto cached =
+          ImageCache::find(mediaId_, QSize(max_width_, max_height_), devicePixelRatioF());
+
+        if (!cached.isNull())
+                setImage(cached);
+}
 
-        client_.data()->downloadImage(QString::fromStdString(event.event_id), url_);
+void
+ImageItem::showEvent(QShowEvent *event)
+{
+        // The thumbnail is requested once the image is shown, so items that
+        // are only measured don't download anything.
+        if (!isThumbnailRequested_ && scaled_image_.isNull() && url_.isValid() &&
+            localFile_.isEmpty()) {
+                isThumbnailRequested_ = true;
+
+                // Only a thumbnail that fits the widget is needed for the
+                // timeline. The original is downloaded on demand when the
+                // image is opened.
+                const auto method    = utils::ThumbnailMethod::Scale;
+                const auto thumbSize = utils::thumbnailSize(
+                  QSize(max_width_, max_height_), qApp->devicePixelRatio(), method);
+
+                client_->downloadThumbnail(
+                  utils::mediaThumbnailUrl(client_->getHomeServer(), mediaId_, thumbSize, method),
+                  QSize(max_width_, max_height_),
+                  this,
+                  [this](const QImage &img) { setImage(QPixmap::fromImage(img)); });
+        }
 
-        connect(client_.data(),
-                SIGNAL(imageDownloaded(const QString &, const QPixmap &)),
-                this,
-                SLOT(imageDownloaded(const QString &, const QPixmap &)));
+        QWidget::showEvent(event);
 }
 
 ImageItem::ImageItem(QSharedPointer<MatrixClient> client,
@@ -71,67 +96,70 @@ ImageItem::ImageItem(QSharedPointer<MatrixClient> client,
         setCursor(Qt::PointingHandCursor);
         setAttribute(Qt::WA_Hover, true);
 
-        QList<QString> url_parts = url_.toString().split("mxc://");
+        const auto mxcUrl = url_.toString();
+        url_              = utils::mediaDownloadUrl(client_->getHomeServer(), mxcUrl);
+        mediaId_          = mxcUrl;
+        localFile_        = filename;
 
-        if (url_parts.size() != 2) {
-                qDebug() << "Invalid format for image" << url_.toString();
+        if (!url_.isValid()) {
+                qDebug() << "Invalid format for image" << mxcUrl;
                 return;
         }
 
-        QString media_params = url_parts[1];
-        url_                 = QString("%1/_matrix/media/r0/download/%2")
-                 .arg(client_.data()->getHomeServer().toString(), media_params);
-
         setImage(QPixmap(filename));
 }
 
 void
-ImageItem::imageDownloaded(const QString &event_id, const QPixmap &img)
+ImageItem::imageDownloaded(const QImage &img)
 {
-        if (event_id != QString::fromStdString(event_.event_id))
+        if (!isOverlayRequested_)
                 return;
 
-        setImage(img);
+        isOverlayRequested_ = false;
+
+        auto image_dialog = new dialogs::ImageOverlay(QPixmap::fromImage(img), mediaId_, this);
+        image_dialog->show();
 }
 
 void
-ImageItem::openUrl()
+ImageItem::openOverlay()
 {
-        if (url_.toString().isEmpty())
+        const auto cached = dialogs::ImageOverlay::cachedImage(mediaId_);
+
+        if (!cached.isNull()) {
+                auto image_dialog = new dialogs::ImageOverlay(cached, mediaId_, this);
+                image_dialog->show();
                 return;
+        }
 
-        if (!QDesktopServices::openUrl(url_))
-                qWarning() << "Could not open url" << url_.toString();
+        // Local echoes have the original image on disk.
+        if (event_.event_id.empty()) {
+                auto image_dialog = new dialogs::ImageOverlay(QPixmap(localFile_), mediaId_, this);
+                image_dialog->show();
+                return;
+        }
+
+        if (isOverlayRequested_)
+                return;
+
+        isOverlayRequested_ = true;
+        client_->downloadImage(url_, this, [this](const QImage &img) { imageDownloaded(img); });
 }
 
 void
-ImageItem::scaleImage()
+ImageItem::openUrl()
 {
-        if (image_.isNull())
+        if (url_.toString().isEmpty())
                 return;
 
-        auto width_ratio  = (double)max_width_ / (double)image_.width();
-        auto height_ratio = (double)max_height_ / (double)image_.height();
-
-        auto min_aspect_ratio = std::min(width_ratio, height_ratio);
-
-        if (min_aspect_ratio > 1) {
-                width_  = image_.width();
-                height_ = image_.height();
-        } else {
-                width_  = image_.width() * min_aspect_ratio;
-                height_ = image_.height() * min_aspect_ratio;
-        }
-
-        setFixedSize(width_, height_);
-        scaled_image_ =
-          image_.scaled(width_, height_, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (!QDesktopServices::openUrl(url_))
+                qWarning() << "Could not open url" << url_.toString();
 }
 
 QSize
 ImageItem::sizeHint() const
 {
-        if (image_.isNull())
+        if (scaled_image_.isNull())
                 return QSize(max_width_, bottom_height_);
 
         return QSize(width_, height_);
@@ -140,8 +168,20 @@ ImageItem::sizeHint() const
 void
 ImageItem::setImage(const QPixmap &image)
 {
-        image_ = image;
-        scaleImage();
+        // The widget has a fixed size, so the image only needs to be scaled
+        // once.
+        scaled_image_ =
+          ImageCache::fitted(mediaId_, image, QSize(max_width_, max_height_), devicePixelRatioF());
+
+        if (scaled_image_.isNull())
+                return;
+
+        const auto size = scaled_image_.size() / scaled_image_.devicePixelRatio();
+
+        width_  = size.width();
+        height_ = size.height();
+
+        setFixedSize(width_, height_);
         update();
 }
 
@@ -151,7 +191,7 @@ ImageItem::mousePressEvent(QMouseEvent *event)
         if (event->button() != Qt::LeftButton)
                 return;
 
-        if (image_.isNull()) {
+        if (scaled_image_.isNull()) {
                 openUrl();
                 return;
         }
@@ -162,19 +202,10 @@ ImageItem::mousePressEvent(QMouseEvent *event)
         if (QRect(0, height_ - bottom_height_, width_, bottom_height_).contains(point)) {
                 openUrl();
         } else {
-                auto image_dialog = new dialogs::ImageOverlay(image_, this);
-                image_dialog->show();
+                openOverlay();
         }
 }
 
-void
-ImageItem::resizeEvent(QResizeEvent *event)
-{
-        Q_UNUSED(event);
-
-        scaleImage();
-}
-
 void
 ImageItem::paintEvent(QPaintEvent *event)
 {
@@ -189,7 +220,7 @@ ImageItem::paintEvent(QPaintEvent *event)
         QFontMetrics metrics(font);
         int fontHeight = metrics.height();
 
-        if (image_.isNull()) {
+        if (scaled_image_.isNull()) {
                 int height = fontHeight + 10;
 
                 QString elidedText = metrics.elidedText(text_, Qt::ElideRight, max_width_ - 10);
@@ -203,7 +234,7 @@ ImageItem::paintEvent(QPaintEvent *event)
                 return;
         }
 
-        painter.fillRect(QRect(0, 0, width_, height_), scaled_image_);
+        painter.drawPixmap(QRect(0, 0, width_, height_), scaled_image_);
 
         if (underMouse()) {
                 // Bottom text section
@@ -0,0 +1,250 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCache>
+#include <QFontDatabase>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include "timeline/widgets/MessageLabel.h"
+
+namespace {
+struct LayoutHeight
+{
+        int width;
+        int height;
+        // Whether the height was computed by the label itself or estimated in
+        // a worker thread.
+        bool isExact;
+};
+
+// The known heights of a text, least recently used first.
+using Heights = QVector<LayoutHeight>;
+
+// Number of texts whose heights are kept.
+constexpr int MaxCachedTexts = 5000;
+// Number of widths kept per text.
+constexpr int MaxCachedWidths = 4;
+
+QMutex cacheMutex;
+QCache<QString, Heights> cache(MaxCachedTexts);
+
+// Layouts have their own pool, so a resize doesn't hold up the work queued on
+// the global one.
+Q_GLOBAL_STATIC(QThreadPool, layoutPool)
+
+int
+indexOfWidth(const Heights &heights, int width)
+{
+        for (int i = 0; i < heights.size(); ++i) {
+                if (heights[i].width == width)
+                        return i;
+        }
+
+        return -1;
+}
+
+bool
+cachedHeight(const QString &key, int width, LayoutHeight *result)
+{
+        QMutexLocker lock(&cacheMutex);
+
+        const auto heights = cache.object(key);
+
+        if (!heights)
+                return false;
+
+        const int i = indexOfWidth(*heights, width);
+
+        if (i == -1)
+                return false;
+
+        // Mark the width as the most recently used.
+        *result = heights->takeAt(i);
+        heights->append(*result);
+
+        return true;
+}
+
+// Height for the closest width that has been computed, if any.
+bool
+nearestHeight(const QString &key, int width, int *result)
+{
+        QMutexLocker lock(&cacheMutex);
+
+        const auto heights = cache.object(key);
+
+        if (!heights || heights->isEmpty())
+                return false;
+
+        auto nearest = heights->constBegin();
+
+        for (auto it = heights->constBegin(); it != heights->constEnd(); ++it) {
+                if (qAbs(it->width - width) < qAbs(nearest->width - width))
+                        nearest = it;
+        }
+
+        *result = nearest->height;
+        return true;
+}
+
+void
+storeHeight(const QString &key, LayoutHeight height)
+{
+        QMutexLocker lock(&cacheMutex);
+
+        auto heights = cache.object(key);
+
+        if (!heights) {
+                heights = new Heights;
+                cache.insert(key, heights);
+        }
+
+        const int i = indexOfWidth(*heights, height.width);
+
+        if (i != -1) {
+                // An estimate shouldn't replace the height given by the label.
+                if (!height.isExact && heights->at(i).isExact)
+                        return;
+
+                heights->remove(i);
+        } else if (heights->size() >= MaxCachedWidths) {
+                heights->removeFirst();
+        }
+
+        heights->append(height);
+}
+}
+
+MessageLabel::MessageLabel(QWidget *parent)
+  : QLabel(parent)
+  , generation_{new QAtomicInt(0)}
+{}
+
+QString
+MessageLabel::cacheKey() const
+{
+        return font().key() + text();
+}
+
+int
+MessageLabel::heightForWidth(int width) const
+{
+        if (!wordWrap() || width < 0)
+                return QLabel::heightForWidth(width);
+
+        const auto key        = cacheKey();
+        const bool isOnScreen = !visibleRegion().isEmpty();
+
+        LayoutHeight cached;
+
+        if (cachedHeight(key, width, &cached) && (cached.isExact || !isOnScreen)) {
+                hasEstimatedHeight_ = !cached.isExact;
+                return cached.height;
+        }
+
+        int nearest = 0;
+
+        if (!isOnScreen && nearestHeight(key, width, &nearest) &&
+            QFontDatabase::supportsThreadedFontRendering()) {
+                // Use the estimate until the worker is done, so the layout
+                // isn't scheduled again by the next layout pass.
+                storeHeight(key, {width, nearest, false});
+                scheduleLayout(width);
+
+                hasEstimatedHeight_ = true;
+                return nearest;
+        }
+
+        const int height = QLabel::heightForWidth(width);
+        storeHeight(key, {width, height, true});
+
+        hasEstimatedHeight_ = false;
+        return height;
+}
+
+void
+MessageLabel::scheduleLayout(int width) const
+{
+        auto label = const_cast<MessageLabel *>(this);
+
+        if (!layoutTimer_) {
+                layoutTimer_ = new QTimer(label);
+                layoutTimer_->setSingleShot(true);
+                layoutTimer_->setInterval(LayoutDelay);
+
+                QObject::connect(
+                  layoutTimer_, &QTimer::timeout, label, [label]() { label->startLayout(); });
+        }
+
+        // A job that is queued for the previous width is no longer needed.
+        generation_->ref();
+
+        pendingWidth_ = width;
+        layoutTimer_->start();
+}
+
+void
+MessageLabel::startLayout() const
+{
+        const auto margins = contentsMargins();
+        const int hextra   = 2 * margin() + margins.left() + margins.right();
+        const int vextra   = 2 * margin() + margins.top() + margins.bottom();
+
+        const auto key    = cacheKey();
+        const auto html   = text();
+        const auto font   = this->font();
+        const int width   = pendingWidth_;
+        const auto count  = generation_;
+        const int current = count->load();
+
+        // Lay out the text the way QLabel does, with a document detached
+        // from any widget.
+        auto future = QtConcurrent::run(layoutPool(), [=]() {
+                if (count->load() != current)
+                        return;
+
+                QTextDocument doc;
+                doc.setDefaultFont(font);
+                doc.setHtml(html);
+                doc.setTextWidth(qMax(width - hextra, 0));
+
+                const int height = qCeil(doc.size().height()) + vextra;
+                storeHeight(key, {width, height, false});
+        });
+
+        // The watcher is destroyed along with the label, so a stale result
+        // is simply left in the cache.
+        auto label   = const_cast<MessageLabel *>(this);
+        auto watcher = new QFutureWatcher<void>(label);
+
+        QObject::connect(
+          watcher, &QFutureWatcher<void>::finished, label, [label, watcher, count, current]() {
+                  if (count->load() == current)
+                          label->updateGeometry();
+
+                  watcher->deleteLater();
+          });
+
+        watcher->setFuture(future);
+}
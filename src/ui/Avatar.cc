@@ -1,7 +1,32 @@
+#include <QCache>
 #include <QPainter>
 
 #include "Avatar.h"
 
+namespace {
+// Budget for the pre-rendered avatars in KiB.
+constexpr int MaxCachedCost = 8 * 1024;
+
+// Circular avatars ready to be painted, keyed by their content, size and
+// device pixel ratio. Least recently used entries are evicted first.
+QCache<QString, QPixmap> renderedAvatars(MaxCachedCost);
+
+QPixmap
+findRendered(const QString &key)
+{
+        auto pixmap = renderedAvatars.object(key);
+
+        return pixmap ? *pixmap : QPixmap();
+}
+
+void
+insertRendered(const QString &key, const QPixmap &pixmap)
+{
+        const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024;
+        renderedAvatars.insert(key, new QPixmap(pixmap), qMax(1, cost));
+}
+}
+
 Avatar::Avatar(QWidget *parent)
   : QWidget(parent)
 {
@@ -15,6 +40,8 @@ Avatar::Avatar(QWidget *parent)
 
         QSizePolicy policy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
         setSizePolicy(policy);
+
+        updatePixmap();
 }
 
 Avatar::~Avatar() {}
@@ -53,12 +80,14 @@ void
 Avatar::setTextColor(const QColor &color)
 {
         text_color_ = color;
+        updatePixmap();
 }
 
 void
 Avatar::setBackgroundColor(const QColor &color)
 {
         background_color_ = color;
+        updatePixmap();
 }
 
 void
@@ -66,15 +95,11 @@ Avatar::setSize(int size)
 {
         size_ = size;
 
-        if (!image_.isNull()) {
-                pixmap_ = QPixmap::fromImage(
-                  image_.scaled(size_, size_, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-        }
-
         QFont _font(font());
         _font.setPointSizeF(size_ * (ui::FontSize) / 40);
 
         setFont(_font);
+        updatePixmap();
         update();
 }
 
@@ -83,19 +108,83 @@ Avatar::setLetter(const QChar &letter)
 {
         letter_ = letter;
         type_   = ui::AvatarType::Letter;
+        updatePixmap();
         update();
 }
 
 void
 Avatar::setImage(const QImage &image)
 {
-        image_  = image;
-        type_   = ui::AvatarType::Image;
-        pixmap_ = QPixmap::fromImage(
-          image_.scaled(size_, size_, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        image_ = image;
+        type_  = ui::AvatarType::Image;
+        updatePixmap();
         update();
 }
 
+void
+Avatar::updatePixmap()
+{
+        const qreal ratio = devicePixelRatioF();
+        const int side    = qRound(size_ * ratio);
+
+        QString key;
+
+        // Images are identified by their cache key, which is shared by all
+        // the copies of an image, e.g the avatar of a user in every message.
+        if (type_ == ui::AvatarType::Image)
+                key = QString("image:%1").arg(image_.cacheKey());
+        else if (type_ == ui::AvatarType::Letter)
+                key = QString("letter:%1:%2:%3:%4")
+                        .arg(letter_)
+                        .arg(backgroundColor().rgba())
+                        .arg(textColor().rgba())
+                        .arg(font().key());
+        else
+                return;
+
+        key += QString(":%1@%2").arg(side).arg(ratio);
+
+        pixmap_ = findRendered(key);
+
+        if (!pixmap_.isNull() || side <= 0)
+                return;
+
+        QPixmap pixmap(side, side);
+        pixmap.setDevicePixelRatio(ratio);
+        pixmap.fill(Qt::transparent);
+
+        // The painter works in logical pixels from here on.
+        QPainter painter(&pixmap);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+
+        const QRect area(0, 0, size_, size_);
+
+        // The circle is filled instead of clipped, so that its edge is
+        // antialiased.
+        if (type_ == ui::AvatarType::Image) {
+                QBrush brush(
+                  image_.scaled(side, side, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+                brush.setTransform(QTransform::fromScale(1 / ratio, 1 / ratio));
+
+                painter.setBrush(brush);
+                painter.drawEllipse(area);
+        } else {
+                painter.setBrush(backgroundColor());
+                painter.drawEllipse(area);
+
+                painter.setFont(font());
+                painter.setPen(textColor());
+                painter.drawText(area.translated(0, -1), Qt::AlignCenter, letter_);
+        }
+
+        painter.end();
+
+        insertRendered(key, pixmap);
+
+        pixmap_ = pixmap;
+}
+
 void
 Avatar::setIcon(const QIcon &icon)
 {
@@ -113,39 +202,23 @@ Avatar::paintEvent(QPaintEvent *)
         QRect r      = rect();
         const int hs = size_ / 2;
 
-        if (type_ != ui::AvatarType::Image) {
-                QBrush brush;
-                brush.setStyle(Qt::SolidPattern);
-                brush.setColor(backgroundColor());
-
-                painter.setPen(Qt::NoPen);
-                painter.setBrush(brush);
-                painter.drawEllipse(r.center(), hs, hs);
-        }
-
-        switch (type_) {
-        case ui::AvatarType::Icon: {
-                icon_.paint(&painter,
-                            QRect((width() - hs) / 2, (height() - hs) / 2, hs, hs),
-                            Qt::AlignCenter,
-                            QIcon::Normal);
-                break;
-        }
-        case ui::AvatarType::Image: {
-                QPainterPath ppath;
-                ppath.addEllipse(width() / 2 - hs, height() / 2 - hs, size_, size_);
-                painter.setClipPath(ppath);
+        // Images and letters are pre-rendered.
+        if (type_ != ui::AvatarType::Icon) {
                 painter.drawPixmap(QRect(width() / 2 - hs, height() / 2 - hs, size_, size_),
                                    pixmap_);
-                break;
-        }
-        case ui::AvatarType::Letter: {
-                painter.setPen(textColor());
-                painter.setBrush(Qt::NoBrush);
-                painter.drawText(r.translated(0, -1), Qt::AlignCenter, letter_);
-                break;
-        }
-        default:
-                break;
+                return;
         }
+
+        QBrush brush;
+        brush.setStyle(Qt::SolidPattern);
+        brush.setColor(backgroundColor());
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(brush);
+        painter.drawEllipse(r.center(), hs, hs);
+
+        icon_.paint(&painter,
+                    QRect((width() - hs) / 2, (height() - hs) / 2, hs, hs),
+                    Qt::AlignCenter,
+                    QIcon::Normal);
 }
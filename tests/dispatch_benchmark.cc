@@ -0,0 +1,142 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "EventDispatch.h"
+#include "events.h"
+
+namespace {
+using Aliases           = mtx::events::StateEvent<mtx::events::state::Aliases>;
+using Avatar            = mtx::events::StateEvent<mtx::events::state::Avatar>;
+using CanonicalAlias    = mtx::events::StateEvent<mtx::events::state::CanonicalAlias>;
+using Create            = mtx::events::StateEvent<mtx::events::state::Create>;
+using HistoryVisibility = mtx::events::StateEvent<mtx::events::state::HistoryVisibility>;
+using JoinRules         = mtx::events::StateEvent<mtx::events::state::JoinRules>;
+using Member            = mtx::events::StateEvent<mtx::events::state::Member>;
+using Name              = mtx::events::StateEvent<mtx::events::state::Name>;
+using PowerLevels       = mtx::events::StateEvent<mtx::events::state::PowerLevels>;
+using Topic             = mtx::events::StateEvent<mtx::events::state::Topic>;
+
+using Audio  = mtx::events::RoomEvent<mtx::events::msg::Audio>;
+using Emote  = mtx::events::RoomEvent<mtx::events::msg::Emote>;
+using File   = mtx::events::RoomEvent<mtx::events::msg::File>;
+using Image  = mtx::events::RoomEvent<mtx::events::msg::Image>;
+using Notice = mtx::events::RoomEvent<mtx::events::msg::Notice>;
+using Text   = mtx::events::RoomEvent<mtx::events::msg::Text>;
+using Video  = mtx::events::RoomEvent<mtx::events::msg::Video>;
+
+struct SenderOf
+{
+        using result_type = const std::string *;
+
+        template<class Event>
+        auto operator()(const Event &event) const -> decltype(&event.sender)
+        {
+                return &event.sender;
+        }
+
+        const std::string *fallback() const { return nullptr; }
+};
+
+using TimelineEvents = mtx::events::collections::TimelineEvents;
+
+template<int = 0>
+std::string
+senderOf(const TimelineEvents &)
+{
+        return "";
+}
+
+// The if-else chain that the timeline used before the dispatch table, which
+// tests the alternatives in turn and copies the event out.
+template<class Event, class... Rest>
+std::string
+senderOf(const TimelineEvents &event)
+{
+        if (mpark::holds_alternative<Event>(event)) {
+                auto msg = mpark::get<Event>(event);
+                return msg.sender;
+        }
+
+        return senderOf<Rest...>(event);
+}
+
+// A timeline of mostly text messages with a few member events.
+mtx::responses::Timeline
+timeline()
+{
+        auto list = nlohmann::json::array();
+
+        for (int i = 0; i < 1000; ++i) {
+                if (i % 10 == 0)
+                        list.push_back(events::member(i, i));
+                else
+                        list.push_back(events::text(i, events::userId(i % 10), "Hello", i));
+        }
+
+        return events::timeline(list);
+}
+}
+
+static void
+BM_DispatchTable(benchmark::State &state)
+{
+        const auto events = timeline().events;
+
+        for (auto _ : state) {
+                for (const auto &event : events)
+                        benchmark::DoNotOptimize(dispatch::visit(SenderOf{}, event));
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * events.size());
+}
+BENCHMARK(BM_DispatchTable);
+
+static void
+BM_HoldsAlternativeChain(benchmark::State &state)
+{
+        const auto events = timeline().events;
+
+        for (auto _ : state) {
+                for (const auto &event : events)
+                        benchmark::DoNotOptimize(senderOf<Aliases,
+                                                          Avatar,
+                                                          CanonicalAlias,
+                                                          Create,
+                                                          HistoryVisibility,
+                                                          JoinRules,
+                                                          Name,
+                                                          Member,
+                                                          PowerLevels,
+                                                          Topic,
+                                                          Audio,
+                                                          Emote,
+                                                          File,
+                                                          Image,
+                                                          Notice,
+                                                          Text,
+                                                          Video>(event));
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * events.size());
+}
+BENCHMARK(BM_HoldsAlternativeChain);
+
+BENCHMARK_MAIN();
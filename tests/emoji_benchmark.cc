@@ -0,0 +1,69 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QStringList>
+
+#include <benchmark/benchmark.h>
+
+#include "emoji/Segmenter.h"
+
+namespace {
+// Message bodies as the timeline formats them, already escaped and linkified.
+const QStringList &
+messages(int kind)
+{
+        static const QStringList plain = {
+          "Did you see the new release? It's at <a "
+          "href=\"https://github.com/mujx/nheko\">https://github.com/mujx/nheko</a>.",
+          "This is a longer message without any emoji in it, which is the common case in most "
+          "rooms, so the ASCII runs should be skipped in bulk.",
+          "ok &amp; thanks",
+        };
+
+        static const QStringList withEmoji = {
+          QString::fromUtf8("Nice work 👍 see you tomorrow 😀"),
+          QString::fromUtf8("Family: 👨‍👩‍👧‍👦, flag: 🇬🇷, keycap: 1️⃣, skin tone: 👋🏽"),
+          QString::fromUtf8("Non-emoji symbols like → and ✓ stay as they are ☕"),
+        };
+
+        return kind == 0 ? plain : withEmoji;
+}
+}
+
+// Formats the plain messages, or the ones with emoji when the argument is 1,
+// one at a time like the timeline items do.
+static void
+BM_FormatHtml(benchmark::State &state)
+{
+        const auto &bodies = messages(state.range(0));
+
+        int64_t bytes = 0;
+        for (const auto &body : bodies)
+                bytes += body.size() * static_cast<int64_t>(sizeof(QChar));
+
+        for (auto _ : state) {
+                for (const auto &body : bodies)
+                        benchmark::DoNotOptimize(emoji::formatHtml(body));
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * bodies.size());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+}
+BENCHMARK(BM_FormatHtml)->ArgName("emoji")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
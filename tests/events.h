@@ -0,0 +1,99 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <mtx.hpp>
+
+// Builders for the JSON of the events a homeserver sends, so the benchmarks
+// parse them into the same types as a real sync.
+namespace events {
+
+inline std::string
+userId(int n)
+{
+        return "@user" + std::to_string(n) + ":example.org";
+}
+
+inline nlohmann::json
+member(int n, int ts)
+{
+        return {{"type", "m.room.member"},
+                {"event_id", "$member" + std::to_string(n) + ":example.org"},
+                {"sender", userId(n)},
+                {"state_key", userId(n)},
+                {"origin_server_ts", ts},
+                {"unsigned", {{"age", 0}}},
+                {"content",
+                 {{"membership", "join"}, {"displayname", "User " + std::to_string(n)}}}};
+}
+
+inline nlohmann::json
+text(int n, const std::string &sender, const std::string &body, int ts)
+{
+        return {{"type", "m.room.message"},
+                {"event_id", "$message" + std::to_string(n) + ":example.org"},
+                {"sender", sender},
+                {"origin_server_ts", ts},
+                {"unsigned", {{"age", 0}}},
+                {"content", {{"msgtype", "m.text"}, {"body", body}}}};
+}
+
+inline nlohmann::json
+timeline(const nlohmann::json &events)
+{
+        return {{"events", events}, {"limited", false}, {"prev_batch", "prev"}};
+}
+
+// A joined room with `members` members, who have all sent a message.
+inline nlohmann::json
+joinedRoom(int members)
+{
+        auto state    = nlohmann::json::array();
+        auto messages = nlohmann::json::array();
+
+        for (int i = 0; i < members; ++i) {
+                state.push_back(member(i, i));
+                messages.push_back(text(i, userId(i), "Hello from " + userId(i), members + i));
+        }
+
+        return {{"state", {{"events", state}}},
+                {"timeline", timeline(messages)},
+                {"ephemeral", {{"events", nlohmann::json::array()}}},
+                {"account_data", {{"events", nlohmann::json::array()}}},
+                {"unread_notifications", {{"highlight_count", 0}, {"notification_count", 0}}}};
+}
+
+inline nlohmann::json
+sync(int rooms, int members)
+{
+        nlohmann::json joined = nlohmann::json::object();
+
+        for (int i = 0; i < rooms; ++i)
+                joined["!room" + std::to_string(i) + ":example.org"] = joinedRoom(members);
+
+        return {{"next_batch", "next"},
+                {"rooms",
+                 {{"join", joined},
+                  {"invite", nlohmann::json::object()},
+                  {"leave", nlohmann::json::object()}}},
+                {"presence", {{"events", nlohmann::json::array()}}},
+                {"account_data", {{"events", nlohmann::json::array()}}}};
+}
+} // namespace events
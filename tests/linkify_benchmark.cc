@@ -0,0 +1,83 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QStringList>
+
+#include <benchmark/benchmark.h>
+
+#include "Utils.h"
+
+namespace {
+// Roughly one MiB of chat messages with links, ids and markup mixed in.
+QString
+messages()
+{
+        const QStringList lines = {
+          "Hey, did you see the new release? It's at https://github.com/mujx/nheko/releases.",
+          "ping @alice:example.org and #nheko:matrix.org about it",
+          "mail me at bob@example.org (or not), <b>whatever</b> works & thanks!",
+          "This is a longer message without any links in it, which is the common case in "
+          "most rooms, so it should be handled without scanning the text more than needed.",
+          "See (https://en.wikipedia.org/wiki/Bar_(band)) for the details\nand more",
+        };
+
+        QString text;
+
+        while (text.size() < 512 * 1024) {
+                for (const auto &line : lines)
+                        text += line + "\n";
+        }
+
+        return text;
+}
+
+void
+bytesProcessed(benchmark::State &state, const QString &text)
+{
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * text.size() *
+                                static_cast<int64_t>(sizeof(QChar)));
+}
+}
+
+static void
+BM_LinkifyMessages(benchmark::State &state)
+{
+        const auto text = messages();
+
+        for (auto _ : state)
+                benchmark::DoNotOptimize(utils::linkifyMessage(text));
+
+        bytesProcessed(state, text);
+}
+BENCHMARK(BM_LinkifyMessages);
+
+// A single token without any match, which a backtracking matcher would scan
+// over and over.
+static void
+BM_LinkifyLongToken(benchmark::State &state)
+{
+        const QString text(512 * 1024, '@');
+
+        for (auto _ : state)
+                benchmark::DoNotOptimize(utils::linkifyMessage(text));
+
+        bytesProcessed(state, text);
+}
+BENCHMARK(BM_LinkifyLongToken);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,234 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <random>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QGuiApplication>
+
+#include <gtest/gtest.h>
+
+#include "RoomListModel.h"
+
+namespace {
+QString
+roomId(int n)
+{
+        return QString("!room%1:example.org").arg(n);
+}
+
+RoomListEntry
+room(int n, qint64 lastActivity, int unreadCount)
+{
+        RoomListEntry entry;
+        entry.roomId               = roomId(n);
+        entry.lastMessage.datetime = QDateTime::fromMSecsSinceEpoch(lastActivity);
+        entry.unreadCount          = unreadCount;
+
+        return entry;
+}
+
+DescInfo
+message(qint64 lastActivity)
+{
+        DescInfo info;
+        info.datetime = QDateTime::fromMSecsSinceEpoch(lastActivity);
+
+        return info;
+}
+
+// The order of the room list: rooms with unread messages first, then the
+// most recently active, then by room id.
+bool
+listedBefore(const RoomListEntry &a, const RoomListEntry &b)
+{
+        const bool pinnedA = a.unreadCount > 0;
+        const bool pinnedB = b.unreadCount > 0;
+
+        if (pinnedA != pinnedB)
+                return pinnedA;
+
+        const auto activityA = a.lastMessage.datetime.toMSecsSinceEpoch();
+        const auto activityB = b.lastMessage.datetime.toMSecsSinceEpoch();
+
+        if (activityA != activityB)
+                return activityA > activityB;
+
+        return a.roomId < b.roomId;
+}
+
+::testing::AssertionResult
+isConsistent(const RoomListModel &model)
+{
+        for (int row = 1; row < model.rowCount(); ++row) {
+                if (!listedBefore(model.room(row - 1), model.room(row)))
+                        return ::testing::AssertionFailure()
+                               << "rows " << row - 1 << " and " << row << " are out of order";
+        }
+
+        // A room is found by a binary search on the key it was sorted with.
+        for (int row = 0; row < model.rowCount(); ++row) {
+                const auto &id = model.room(row).roomId;
+
+                if (model.indexOf(id).row() != row)
+                        return ::testing::AssertionFailure()
+                               << id.toStdString() << " isn't found at row " << row;
+        }
+
+        return ::testing::AssertionSuccess();
+}
+}
+
+TEST(RoomListModel, InitialRoomsAreSorted)
+{
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> activity(0, 20);
+        std::uniform_int_distribution<int> unread(0, 3);
+
+        std::vector<RoomListEntry> rooms;
+        for (int i = 0; i < 100; ++i)
+                rooms.push_back(room(i, activity(random), unread(random)));
+
+        RoomListModel model;
+        model.setRooms(std::move(rooms));
+
+        EXPECT_EQ(model.rowCount(), 100);
+        EXPECT_TRUE(isConsistent(model));
+}
+
+TEST(RoomListModel, AddedRoomsAreInserted)
+{
+        RoomListModel model;
+        model.addRoom(room(1, 10, 0));
+        model.addRoom(room(2, 30, 0));
+        model.addRoom(room(3, 20, 1));
+        model.addRoom(room(4, 20, 0));
+        model.addRoom(room(0, 20, 0));
+
+        ASSERT_EQ(model.rowCount(), 5);
+        EXPECT_EQ(model.room(0).roomId, roomId(3));
+        EXPECT_EQ(model.room(1).roomId, roomId(2));
+        EXPECT_EQ(model.room(2).roomId, roomId(0));
+        EXPECT_EQ(model.room(3).roomId, roomId(4));
+        EXPECT_EQ(model.room(4).roomId, roomId(1));
+        EXPECT_TRUE(isConsistent(model));
+
+        // Adding a room twice keeps the first one.
+        model.addRoom(room(1, 50, 0));
+        EXPECT_EQ(model.rowCount(), 5);
+        EXPECT_EQ(model.room(4).roomId, roomId(1));
+}
+
+TEST(RoomListModel, UpdatesMoveRooms)
+{
+        RoomListModel model;
+        for (int i = 0; i < 5; ++i)
+                model.addRoom(room(i, 10 * i, 0));
+
+        // The oldest room moves up to the top.
+        model.setLastMessage(roomId(0), message(100));
+        EXPECT_EQ(model.room(0).roomId, roomId(0));
+        EXPECT_TRUE(isConsistent(model));
+
+        // The newest room moves down to the bottom.
+        model.setLastMessage(roomId(0), message(0));
+        EXPECT_EQ(model.room(4).roomId, roomId(0));
+        EXPECT_TRUE(isConsistent(model));
+
+        model.addUnreadCount(roomId(1), 2);
+        EXPECT_EQ(model.room(0).roomId, roomId(1));
+        EXPECT_TRUE(isConsistent(model));
+
+        EXPECT_EQ(model.clearUnreadCount(roomId(1)), 2);
+        EXPECT_EQ(model.room(3).roomId, roomId(1));
+        EXPECT_TRUE(isConsistent(model));
+
+        EXPECT_EQ(model.clearUnreadCount(roomId(1)), 0);
+}
+
+TEST(RoomListModel, RandomUpdates)
+{
+        constexpr int Rooms = 200;
+
+        std::mt19937 random(42);
+        // A narrow range of timestamps, so many rooms tie on their activity.
+        std::uniform_int_distribution<int> activity(0, 50);
+        std::uniform_int_distribution<int> unread(1, 3);
+        std::uniform_int_distribution<int> roomIndex(0, Rooms - 1);
+        std::uniform_int_distribution<int> operation(0, 4);
+
+        std::vector<RoomListEntry> rooms;
+        for (int i = 0; i < Rooms; ++i)
+                rooms.push_back(room(i, activity(random), 0));
+
+        RoomListModel model;
+        model.setRooms(std::move(rooms));
+        ASSERT_TRUE(isConsistent(model));
+
+        for (int step = 0; step < 2000; ++step) {
+                const int n = roomIndex(random);
+
+                switch (operation(random)) {
+                case 0:
+                case 1:
+                        model.setLastMessage(roomId(n), message(activity(random)));
+                        break;
+                case 2:
+                        model.addUnreadCount(roomId(n), unread(random));
+                        break;
+                case 3:
+                        model.clearUnreadCount(roomId(n));
+                        break;
+                case 4:
+                        if (model.contains(roomId(n)))
+                                model.removeRoom(roomId(n));
+                        else
+                                model.addRoom(room(n, activity(random), 0));
+                        break;
+                }
+
+                ASSERT_TRUE(isConsistent(model)) << "after step " << step;
+        }
+
+        // Every room that is listed is found, and no other.
+        for (int i = 0; i < Rooms; ++i) {
+                const auto index = model.indexOf(roomId(i));
+
+                if (model.contains(roomId(i)))
+                        EXPECT_EQ(model.room(index.row()).roomId, roomId(i));
+                else
+                        EXPECT_FALSE(index.isValid());
+        }
+}
+
+int
+main(int argc, char *argv[])
+{
+        // The rooms hold pixmaps, which need a QGuiApplication but no display.
+        if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+                qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        QGuiApplication app(argc, argv);
+        QCoreApplication::setApplicationName("nheko-tests");
+        QCoreApplication::setOrganizationName("nheko");
+
+        ::testing::InitGoogleTest(&argc, argv);
+
+        return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QString>
+
+#include <gtest/gtest.h>
+
+#include "RoomSearchIndex.h"
+#include "RoomState.h"
+
+namespace {
+// The server name has no letters, so the room ids, which are searched too,
+// don't match any of the queries below.
+QString
+roomId(int n)
+{
+        return QString("!%1:10.0.0.1").arg(n);
+}
+
+RoomState
+named(const QString &name)
+{
+        RoomState state;
+        state.name.content.name = name.toStdString();
+        state.resolveName();
+
+        return state;
+}
+
+// The names of the rooms matching the query, best match first.
+std::vector<std::string>
+search(const RoomSearchIndex &index, const QString &query, int limit = 10)
+{
+        std::vector<std::string> names;
+
+        for (const auto &result : index.search(query, limit))
+                names.push_back(result.name.toStdString());
+
+        return names;
+}
+
+using Names = std::vector<std::string>;
+}
+
+TEST(RoomSearchIndex, EmptyQuery)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("General"));
+
+        EXPECT_EQ(search(index, ""), Names());
+        EXPECT_EQ(search(index, "   "), Names());
+        EXPECT_EQ(search(index, "general", 0), Names());
+}
+
+TEST(RoomSearchIndex, Ranking)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("cxhxaxt"));
+        index.insert(roomId(1), named("wechat"));
+        index.insert(roomId(2), named("the chat room"));
+        index.insert(roomId(3), named("chatter"));
+        index.insert(roomId(4), named("chat"));
+        index.insert(roomId(5), named("unrelated"));
+
+        // The worse matches are the most active, which only breaks ties.
+        for (int i = 0; i < 5; ++i)
+                index.setLastActivity(roomId(i), 5 - i);
+
+        // Exact, prefix, word start, substring and subsequence matches.
+        EXPECT_EQ(search(index, "chat"),
+                  Names({"chat", "chatter", "the chat room", "wechat", "cxhxaxt"}));
+        EXPECT_EQ(search(index, "chat", 2), Names({"chat", "chatter"}));
+}
+
+TEST(RoomSearchIndex, TiesByActivity)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("Rust"));
+        index.insert(roomId(1), named("Ruby"));
+        index.insert(roomId(2), named("Rune"));
+
+        index.setLastActivity(roomId(0), 10);
+        index.setLastActivity(roomId(1), 30);
+        index.setLastActivity(roomId(2), 20);
+
+        EXPECT_EQ(search(index, "ru"), Names({"Ruby", "Rune", "Rust"}));
+}
+
+TEST(RoomSearchIndex, ExtendedQueries)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("alpha"));
+        index.insert(roomId(1), named("alps"));
+        index.insert(roomId(2), named("alpine"));
+        index.insert(roomId(3), named("algae"));
+
+        // Each query is only matched against the rooms of the previous one.
+        EXPECT_EQ(search(index, "al").size(), 4u);
+        EXPECT_EQ(search(index, "alp").size(), 3u);
+        EXPECT_EQ(search(index, "alps"), Names({"alps"}));
+
+        // A shorter query is matched against all the rooms again.
+        EXPECT_EQ(search(index, "alp").size(), 3u);
+        EXPECT_EQ(search(index, "alg"), Names({"algae"}));
+        EXPECT_EQ(search(index, "al").size(), 4u);
+}
+
+TEST(RoomSearchIndex, ExtendedQueriesAfterUpdates)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("alpha"));
+        index.insert(roomId(1), named("alps"));
+        index.insert(roomId(2), named("alpine"));
+
+        EXPECT_EQ(search(index, "al").size(), 3u);
+
+        // The last room takes the place of a removed one.
+        index.remove(roomId(0));
+        EXPECT_EQ(search(index, "alp"), Names({"alps", "alpine"}));
+
+        index.insert(roomId(3), named("alpaca"));
+        EXPECT_EQ(search(index, "alpa"), Names({"alpaca"}));
+
+        EXPECT_EQ(search(index, "al").size(), 3u);
+
+        // A renamed room is matched by its new name only. The equally good
+        // matches are ordered by name.
+        index.insert(roomId(1), named("beta"));
+        EXPECT_EQ(search(index, "alp"), Names({"alpaca", "alpine"}));
+        EXPECT_EQ(search(index, "bet"), Names({"beta"}));
+
+        index.clear();
+        EXPECT_EQ(search(index, "alp"), Names());
+}
+
+TEST(RoomSearchIndex, CharacterFilter)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named("Floor 7"));
+        index.insert(roomId(1), named("Floor 8"));
+        index.insert(roomId(2), named("c++ help"));
+        index.insert(roomId(3), named("50% off"));
+        index.insert(roomId(4), named("[todo]"));
+
+        EXPECT_EQ(search(index, "7"), Names({"Floor 7"}));
+        EXPECT_EQ(search(index, "floor 8"), Names({"Floor 8"}));
+        EXPECT_EQ(search(index, "c++"), Names({"c++ help"}));
+        EXPECT_EQ(search(index, "lp"), Names({"c++ help"}));
+
+        // '%' and ']' share a bit of the filter, which only rules out rooms.
+        EXPECT_EQ(search(index, "%"), Names({"50% off"}));
+        EXPECT_EQ(search(index, "]"), Names({"[todo]"}));
+}
+
+TEST(RoomSearchIndex, CaseFolding)
+{
+        RoomSearchIndex index;
+        index.insert(roomId(0), named(QString::fromUtf8("Ärger")));
+        index.insert(roomId(1), named(QString::fromUtf8("ΣΟΦΙΑ")));
+        index.insert(roomId(2), named(QString::fromUtf8("Émile")));
+        index.insert(roomId(3), named("General"));
+
+        const Names arger({"Ärger"});
+        const Names sofia({"ΣΟΦΙΑ"});
+        const Names emile({"Émile"});
+
+        EXPECT_EQ(search(index, QString::fromUtf8("är")), arger);
+        EXPECT_EQ(search(index, QString::fromUtf8("ÄR")), arger);
+        EXPECT_EQ(search(index, QString::fromUtf8("σοφ")), sofia);
+        EXPECT_EQ(search(index, QString::fromUtf8("ΣοΦ")), sofia);
+        EXPECT_EQ(search(index, QString::fromUtf8("ÉMI")), emile);
+        EXPECT_EQ(search(index, "GENERAL"), Names({"General"}));
+}
+
+int
+main(int argc, char *argv[])
+{
+        // The room names are resolved against the user of the session.
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("nheko-tests");
+        QCoreApplication::setOrganizationName("nheko");
+
+        ::testing::InitGoogleTest(&argc, argv);
+
+        return RUN_ALL_TESTS();
+}
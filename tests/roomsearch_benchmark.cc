@@ -0,0 +1,98 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include <QCoreApplication>
+#include <QString>
+
+#include <benchmark/benchmark.h>
+
+#include "RoomSearchIndex.h"
+#include "RoomState.h"
+
+namespace {
+const char *const Words[] = {"general", "random", "dev",    "matrix", "linux",    "music",
+                             "gaming",  "rust",   "design", "social", "offtopic", "support"};
+constexpr int WordCount = sizeof(Words) / sizeof(Words[0]);
+
+// Rooms named after two words and a number, so a query narrows them down
+// gradually as it is typed.
+void
+fillIndex(RoomSearchIndex &index, int rooms)
+{
+        for (int i = 0; i < rooms; ++i) {
+                RoomState state;
+                state.name.content.name = std::string(Words[i % WordCount]) + " " +
+                                          Words[(i / WordCount) % WordCount] + " " +
+                                          std::to_string(i);
+                state.resolveName();
+
+                const auto roomId = QString("!room%1:example.org").arg(i);
+
+                index.insert(roomId, state);
+                index.setLastActivity(roomId, i);
+        }
+}
+}
+
+// Typing a query one character at a time in the room switcher. Each iteration
+// is one keystroke: the first character of the query searches all the rooms
+// and the following ones only the rooms that matched the previous query.
+static void
+BM_SearchKeystroke(benchmark::State &state)
+{
+        RoomSearchIndex index;
+        fillIndex(index, state.range(0));
+
+        const QString query = "offtopic music 4";
+        int length          = 0;
+
+        for (auto _ : state) {
+                length = length % query.size() + 1;
+
+                benchmark::DoNotOptimize(index.search(query.left(length), 10));
+        }
+}
+BENCHMARK(BM_SearchKeystroke)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// The first keystroke, which always matches against all the rooms.
+static void
+BM_SearchFirstKeystroke(benchmark::State &state)
+{
+        RoomSearchIndex index;
+        fillIndex(index, state.range(0));
+
+        // Alternating queries don't extend each other, so none is narrowed.
+        const QString queries[] = {"r", "m"};
+        int i                   = 0;
+
+        for (auto _ : state)
+                benchmark::DoNotOptimize(index.search(queries[i++ % 2], 10));
+}
+BENCHMARK(BM_SearchFirstKeystroke)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+int
+main(int argc, char *argv[])
+{
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("nheko-benchmarks");
+        QCoreApplication::setOrganizationName("nheko");
+
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+}
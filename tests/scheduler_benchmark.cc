@@ -0,0 +1,98 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+
+#include <benchmark/benchmark.h>
+
+#include "TaskScheduler.h"
+
+// Amount of work in milliseconds that is scheduled per iteration.
+static constexpr int JobLength = 100;
+
+// Runs a job made of chunks that take `state.range(0)` microseconds each,
+// while a zero interval timer stands in for input and paint events. The
+// longest gap between two of its timeouts is the worst latency a user would
+// see, which should stay close to the slice budget.
+static void
+BM_SchedulerLatency(benchmark::State &state)
+{
+        const qint64 chunkLength = state.range(0) * 1000;
+        auto scheduler           = TaskScheduler::instance();
+
+        const int slicesBefore     = scheduler->totalSlices();
+        const int overBudgetBefore = scheduler->overBudgetSlices();
+
+        qint64 longestGap = 0;
+
+        for (auto _ : state) {
+                QObject owner;
+                int remaining = JobLength * 1000 / state.range(0);
+
+                scheduler->schedule(&owner, [&remaining, chunkLength]() {
+                        QElapsedTimer work;
+                        work.start();
+
+                        while (work.nsecsElapsed() < chunkLength)
+                                continue;
+
+                        return --remaining > 0;
+                });
+
+                QEventLoop loop;
+                QElapsedTimer sinceLastEvent;
+                sinceLastEvent.start();
+
+                QTimer input;
+                input.setInterval(0);
+
+                QObject::connect(&input, &QTimer::timeout, [&]() {
+                        longestGap = std::max(longestGap, sinceLastEvent.nsecsElapsed());
+                        sinceLastEvent.restart();
+
+                        if (scheduler->isIdle())
+                                loop.quit();
+                });
+
+                input.start();
+                loop.exec();
+        }
+
+        const auto slices     = scheduler->totalSlices() - slicesBefore;
+        const auto overBudget = scheduler->overBudgetSlices() - overBudgetBefore;
+
+        using benchmark::Counter;
+
+        state.counters["longest_gap_ms"]     = static_cast<double>(longestGap) / 1e6;
+        state.counters["slices"]             = Counter(slices, Counter::kAvgIterations);
+        state.counters["over_budget_slices"] = Counter(overBudget, Counter::kAvgIterations);
+}
+BENCHMARK(BM_SchedulerLatency)->Arg(100)->Arg(1000)->Arg(4000)->Unit(benchmark::kMillisecond);
+
+int
+main(int argc, char *argv[])
+{
+        QCoreApplication app(argc, argv);
+
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,102 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <QCoreApplication>
+#include <QMap>
+#include <QString>
+
+#include <benchmark/benchmark.h>
+
+#include "RoomState.h"
+#include "events.h"
+
+// Counts the allocations made through operator new, i.e by the standard
+// containers and strings of the events. Qt containers allocate with malloc
+// and aren't counted.
+static std::atomic<std::size_t> allocations(0);
+
+void *
+operator new(std::size_t size)
+{
+        allocations += 1;
+
+        if (auto ptr = std::malloc(size))
+                return ptr;
+
+        throw std::bad_alloc();
+}
+
+void
+operator delete(void *ptr) noexcept
+{
+        std::free(ptr);
+}
+
+// The room state stages of ChatPage::initialSyncCompleted and
+// ChatPage::generateMembershipDifference, which need a client and a cache to
+// run as they are: each state is built in place from the events of the
+// response, and the copy stored in the cache shares its member list.
+static void
+BM_ApplySync(benchmark::State &state)
+{
+        const mtx::responses::Sync response = events::sync(state.range(0), state.range(1));
+
+        std::size_t total = 0;
+
+        for (auto _ : state) {
+                const auto before = allocations.load();
+
+                QMap<QString, RoomState> states;
+                QMap<QString, RoomState> stateDiff;
+
+                for (const auto &room : response.rooms.join) {
+                        const auto roomId = QString::fromStdString(room.first);
+
+                        auto &roomState = states[roomId];
+                        roomState.updateFromEvents(room.second.state.events);
+                        roomState.updateFromEvents(room.second.timeline.events);
+                        roomState.resolveName();
+                        roomState.resolveAvatar();
+
+                        stateDiff.insert(roomId, roomState);
+                }
+
+                benchmark::DoNotOptimize(stateDiff);
+
+                total += allocations.load() - before;
+        }
+
+        state.counters["allocs_per_sync"] =
+          benchmark::Counter(static_cast<double>(total), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ApplySync)->Args({10, 500})->Args({200, 20});
+
+int
+main(int argc, char *argv[])
+{
+        // RoomState reads the user id from the session.
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("nheko-benchmarks");
+        QCoreApplication::setOrganizationName("nheko");
+
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,128 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QSharedPointer>
+
+#include <benchmark/benchmark.h>
+
+#include "MatrixClient.h"
+#include "TaskScheduler.h"
+#include "events.h"
+
+#include "timeline/TimelineView.h"
+
+namespace {
+// Messages are added like they arrive from the syncs, so the view hides the
+// older rows as it goes instead of creating a widget for every message.
+constexpr int SyncSize = 500;
+
+void
+processEvents()
+{
+        do {
+                QCoreApplication::processEvents();
+        } while (!TaskScheduler::instance()->isIdle());
+}
+
+void
+addMessages(TimelineView &view, int count)
+{
+        for (int first = 0; first < count; first += SyncSize) {
+                auto list = nlohmann::json::array();
+
+                for (int i = first; i < std::min(first + SyncSize, count); ++i) {
+                        const auto body =
+                          "Message " + std::to_string(i) +
+                          (i % 3 == 0 ? ", which is long enough to wrap to a second line or even "
+                                        "a third one when the window is narrow."
+                                      : "");
+
+                        list.push_back(events::text(i, events::userId(i % 7), body, i * 1000));
+                }
+
+                const mtx::responses::Timeline timeline = events::timeline(list);
+                view.addEvents(timeline);
+
+                processEvents();
+        }
+}
+}
+
+// Scrolls up from the bottom of a room with `state.range(0)` messages, a
+// quarter of the viewport per frame. A frame is the scroll bar update, the
+// items that are restored or hidden because of it and the repaint.
+static void
+BM_ScrollTimeline(benchmark::State &state)
+{
+        QSharedPointer<MatrixClient> client(new MatrixClient("nheko.invalid"));
+
+        TimelineView view(client, "!room:example.org");
+        view.resize(800, 600);
+        view.show();
+
+        addMessages(view, state.range(0));
+
+        auto scrollBar = view.findChild<QScrollArea *>()->verticalScrollBar();
+        const int step = scrollBar->pageStep() / 4;
+
+        qint64 longestFrame = 0;
+
+        for (auto _ : state) {
+                QElapsedTimer frame;
+                frame.start();
+
+                if (scrollBar->value() - step <= scrollBar->minimum())
+                        scrollBar->setValue(scrollBar->maximum());
+                else
+                        scrollBar->setValue(scrollBar->value() - step);
+
+                QCoreApplication::processEvents();
+                view.repaint();
+
+                longestFrame = std::max(longestFrame, frame.nsecsElapsed());
+        }
+
+        state.counters["longest_frame_ms"] = static_cast<double>(longestFrame) / 1e6;
+}
+BENCHMARK(BM_ScrollTimeline)
+  ->Arg(10000)
+  ->Arg(100000)
+  ->Iterations(500)
+  ->Unit(benchmark::kMillisecond);
+
+int
+main(int argc, char *argv[])
+{
+        // The benchmark doesn't need a display.
+        if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+                qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        QApplication app(argc, argv);
+        QCoreApplication::setApplicationName("nheko-benchmarks");
+        QCoreApplication::setOrganizationName("nheko");
+
+        Q_INIT_RESOURCE(res);
+
+        benchmark::Initialize(&argc, argv);
+        benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,171 @@
+/*
+ * nheko Copyright (C) 2017  Konstantinos Sideris <siderisk@auth.gr>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include <QString>
+
+#include <gtest/gtest.h>
+
+#include "Utils.h"
+
+namespace {
+std::string
+linkify(const QString &text)
+{
+        return utils::linkifyMessage(text).toStdString();
+}
+
+std::string
+link(const std::string &href, const std::string &text)
+{
+        return "<a href=\"" + href + "\">" + text + "</a>";
+}
+}
+
+TEST(Linkify, PlainText)
+{
+        EXPECT_EQ(linkify(""), "");
+        EXPECT_EQ(linkify("hello world"), "hello world");
+        EXPECT_EQ(linkify("  leading and trailing  "), "  leading and trailing  ");
+}
+
+TEST(Linkify, UnterminatedMarkup)
+{
+        EXPECT_EQ(linkify("<"), "&lt;");
+        EXPECT_EQ(linkify("a < b"), "a &lt; b");
+        EXPECT_EQ(linkify("<script"), "&lt;script");
+        EXPECT_EQ(linkify("<b>bold"), "&lt;b&gt;bold");
+        EXPECT_EQ(linkify("&"), "&amp;");
+        EXPECT_EQ(linkify("&amp"), "&amp;amp");
+        EXPECT_EQ(linkify("\"quoted"), "&quot;quoted");
+}
+
+TEST(Linkify, IdsWithoutServer)
+{
+        EXPECT_EQ(linkify("@"), "@");
+        EXPECT_EQ(linkify("#"), "#");
+        EXPECT_EQ(linkify("@alice"), "@alice");
+        EXPECT_EQ(linkify("#room"), "#room");
+        EXPECT_EQ(linkify("@alice:"), "@alice:");
+        EXPECT_EQ(linkify("#room:"), "#room:");
+        EXPECT_EQ(linkify("@:example.org"), "@:example.org");
+}
+
+TEST(Linkify, Ids)
+{
+        EXPECT_EQ(linkify("@alice:example.org"),
+                  link("https://matrix.to/#/@alice:example.org", "@alice:example.org"));
+        EXPECT_EQ(linkify("#room:example.org:8448"),
+                  link("https://matrix.to/#/#room:example.org:8448", "#room:example.org:8448"));
+        EXPECT_EQ(linkify("bob@example.org"), link("mailto:bob@example.org", "bob@example.org"));
+        EXPECT_EQ(linkify("bob@localhost"), "bob@localhost");
+}
+
+TEST(Linkify, UrlsWithPunctuation)
+{
+        const auto url = link("https://example.org", "https://example.org");
+
+        EXPECT_EQ(linkify("https://example.org."), url + ".");
+        EXPECT_EQ(linkify("https://example.org,"), url + ",");
+        EXPECT_EQ(linkify("https://example.org?!"), url + "?!");
+        EXPECT_EQ(linkify("(https://example.org)"), "(" + url + ")");
+        EXPECT_EQ(linkify("[https://example.org]."), "[" + url + "].");
+        EXPECT_EQ(linkify("<https://example.org>"), "&lt;" + url + "&gt;");
+        EXPECT_EQ(linkify("\"https://example.org\""), "&quot;" + url + "&quot;");
+        EXPECT_EQ(linkify("https://en.wikipedia.org/wiki/Bar_(band)"),
+                  link("https://en.wikipedia.org/wiki/Bar_(band)",
+                       "https://en.wikipedia.org/wiki/Bar_(band)"));
+}
+
+TEST(Linkify, Urls)
+{
+        EXPECT_EQ(linkify("https://"), "https://");
+        EXPECT_EQ(linkify("ftp://x"), link("ftp://x", "ftp://x"));
+        EXPECT_EQ(linkify("HTTPS://EXAMPLE.ORG"),
+                  link("HTTPS://EXAMPLE.ORG", "HTTPS://EXAMPLE.ORG"));
+        EXPECT_EQ(linkify("https://example.org/?a=1&b=2"),
+                  link("https://example.org/?a=1&amp;b=2", "https://example.org/?a=1&amp;b=2"));
+        EXPECT_EQ(linkify("javascript:alert(1)"), "javascript:alert(1)");
+}
+
+TEST(Linkify, UrlsNextToNewlines)
+{
+        const auto url = link("https://example.org", "https://example.org");
+
+        EXPECT_EQ(linkify("https://example.org\nnext"), url + "<br/>next");
+        EXPECT_EQ(linkify("first\nhttps://example.org"), "first<br/>" + url);
+        EXPECT_EQ(linkify("\nhttps://example.org.\n"), "<br/>" + url + ".<br/>");
+        EXPECT_EQ(linkify("\n\n"), "<br/><br/>");
+}
+
+TEST(Linkify, LongRunsWithoutMatches)
+{
+        const int length = 1 << 20;
+
+        const QString letters(length, 'a');
+        EXPECT_EQ(linkify(letters), letters.toStdString());
+
+        const QString ats(length, '@');
+        EXPECT_EQ(linkify(ats), ats.toStdString());
+
+        const QString colons(length, ':');
+        EXPECT_EQ(linkify(colons), colons.toStdString());
+
+        const QString parentheses(length, '(');
+        EXPECT_EQ(linkify(parentheses), parentheses.toStdString());
+
+        const auto brackets = QString(length, '<').toStdString();
+        std::string escaped;
+        for (int i = 0; i < length; ++i)
+                escaped += "&lt;";
+        EXPECT_EQ(linkify(QString::fromStdString(brackets)), escaped);
+}
+
+TEST(ThumbnailSize, SmallCrops)
+{
+        using utils::ThumbnailMethod;
+
+        EXPECT_EQ(utils::thumbnailSize(QSize(32, 32), 1, ThumbnailMethod::Crop), QSize(32, 32));
+        EXPECT_EQ(utils::thumbnailSize(QSize(40, 40), 2, ThumbnailMethod::Crop), QSize(96, 96));
+        EXPECT_EQ(utils::thumbnailSize(QSize(48, 48), 2, ThumbnailMethod::Crop), QSize(96, 96));
+}
+
+TEST(ThumbnailSize, LargeCropsStaySquare)
+{
+        using utils::ThumbnailMethod;
+
+        EXPECT_EQ(utils::thumbnailSize(QSize(55, 55), 2, ThumbnailMethod::Crop), QSize(320, 320));
+        EXPECT_EQ(utils::thumbnailSize(QSize(48, 48), 2.5, ThumbnailMethod::Crop),
+                  QSize(320, 320));
+        EXPECT_EQ(utils::thumbnailSize(QSize(200, 100), 2, ThumbnailMethod::Crop),
+                  QSize(640, 640));
+        EXPECT_EQ(utils::thumbnailSize(QSize(1000, 1000), 1, ThumbnailMethod::Crop),
+                  QSize(800, 800));
+}
+
+TEST(ThumbnailSize, Scaled)
+{
+        using utils::ThumbnailMethod;
+
+        EXPECT_EQ(utils::thumbnailSize(QSize(100, 100), 1, ThumbnailMethod::Scale),
+                  QSize(320, 240));
+        EXPECT_EQ(utils::thumbnailSize(QSize(300, 300), 1, ThumbnailMethod::Scale),
+                  QSize(640, 480));
+        EXPECT_EQ(utils::thumbnailSize(QSize(400, 300), 2, ThumbnailMethod::Scale),
+                  QSize(800, 600));
+}